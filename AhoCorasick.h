@@ -0,0 +1,415 @@
+// PinkRabbit
+// 2026-10-16
+// Aho-Corasick automaton for a set of keywords, as a DeterministicFiniteAutomaton or a double-array trie
+
+#ifndef AHOCORASICK_H__PINKRABBIT
+#define AHOCORASICK_H__PINKRABBIT
+
+#include "DFA.h"
+
+#define RE(...) void(), std::fprintf(stderr, __VA_ARGS__), std::exit(23), void()
+
+// keywords get ids 0, 1, .. in order of addition, then build() fixes the automaton
+// states are numbered in breadth first order of the trie with the root as state 0,
+// the same numbers are used by toDFA and by the double array
+class AhoCorasick {
+private:
+	Alphabet sig;
+	// trie while keywords are added, children in sibling lists, the root's children in a dense row
+	std::vector<int> firstChild, nextSibling, symbolOf, rootChild;
+	// keywords ending at a node, linked through nextKeyword
+	std::vector<int> keywordAt, nextKeyword, keywordLength;
+	bool built;
+	// after build, in breadth first numbering
+	int n;
+	std::vector<int> childBegin, childSymbol, childTarget; // sorted children of every state
+	std::vector<int> fail, dictLink; // longest proper suffix state, and the nearest one among them with keywords
+	// double array: slot base[s] + symbId is the child of slot s on symbId when check of it is s
+	std::vector<int> base, check, slotFail, slotDict, slotKeyword, slotState, stateSlot;
+	int child(int u, int symbId) const {
+		int lo = childBegin[u], hi = childBegin[u + 1];
+		while (lo < hi) {
+			int mid = (lo + hi) / 2;
+			if (childSymbol[mid] < symbId)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		return lo < childBegin[u + 1] && childSymbol[lo] == symbId ? childTarget[lo] : -1;
+	}
+	void renumber() {
+		int nodes = (int)firstChild.size();
+		std::vector<int> id(nodes, -1), que(1, 0), kids;
+		id[0] = 0;
+		childBegin.assign(1, 0);
+		childSymbol.clear(), childTarget.clear();
+		for (size_t h = 0; h < que.size(); ++h) {
+			int u = que[h];
+			kids.clear();
+			if (u == 0) {
+				for (int j = 0; j < sig.size(); ++j)
+					if (rootChild[j] != -1)
+						kids.push_back(rootChild[j]);
+			}
+			else {
+				for (int v = firstChild[u]; v != -1; v = nextSibling[v])
+					kids.push_back(v);
+				std::sort(kids.begin(), kids.end(), [this](int a, int b) { return symbolOf[a] < symbolOf[b]; });
+			}
+			for (int v : kids) {
+				id[v] = (int)que.size();
+				que.push_back(v);
+				childSymbol.push_back(symbolOf[v]);
+				childTarget.push_back(id[v]);
+			}
+			childBegin.push_back((int)childSymbol.size());
+		}
+		n = nodes;
+		std::vector<int> keywords(n);
+		for (int u = 0; u < nodes; ++u)
+			keywords[id[u]] = keywordAt[u];
+		keywordAt.swap(keywords);
+		std::vector<int>().swap(firstChild), std::vector<int>().swap(nextSibling), std::vector<int>().swap(symbolOf);
+	}
+	void failureLinks() {
+		fail.assign(n, 0);
+		dictLink.assign(n, -1);
+		for (int u = 0; u < n; ++u)
+			for (int i = childBegin[u]; i < childBegin[u + 1]; ++i) {
+				int v = childTarget[i], c = childSymbol[i];
+				if (u != 0) {
+					int f = fail[u], w;
+					while ((w = child(f, c)) == -1 && f != 0)
+						f = fail[f];
+					fail[v] = w == -1 ? 0 : w;
+				}
+				int f = fail[v];
+				dictLink[v] = keywordAt[f] != -1 ? f : dictLink[f];
+			}
+	}
+	// first fit placement, states in breadth first order, free slots kept in a linked list
+	void doubleArray() {
+		base.assign(1, 0), check.assign(1, -1);
+		std::vector<int> nextFree(1, -1), prevFree(1, -1);
+		int freeHead = -1, freeTail = -1;
+		auto grow = [&](int size) {
+			int old = (int)check.size();
+			if (size <= old)
+				return ;
+			base.resize(size, 0), check.resize(size, -1), nextFree.resize(size), prevFree.resize(size);
+			for (int s = old; s < size; ++s) {
+				prevFree[s] = s == old ? -1 : s - 1;
+				nextFree[s] = s + 1 < size ? s + 1 : -1;
+			}
+			if (freeHead == -1)
+				freeHead = old;
+			else
+				nextFree[freeTail] = old, prevFree[old] = freeTail;
+			freeTail = size - 1;
+		};
+		auto take = [&](int s) {
+			if (prevFree[s] != -1)
+				nextFree[prevFree[s]] = nextFree[s];
+			else
+				freeHead = nextFree[s];
+			if (nextFree[s] != -1)
+				prevFree[nextFree[s]] = prevFree[s];
+			else
+				freeTail = prevFree[s];
+		};
+		stateSlot.assign(n, -1);
+		stateSlot[0] = 0;
+		check[0] = 0; // the root is its own parent, no symbol leads to slot 0 since bases are positive
+		for (int u = 0; u < n; ++u) {
+			int lo = childBegin[u], hi = childBegin[u + 1];
+			if (lo == hi)
+				continue;
+			int first = childSymbol[lo], b = -1;
+			grow(first + 2);
+			for (int f = freeHead; ; f = nextFree[f]) {
+				if (f == -1) {
+					// no fit among the free slots, append after the current end
+					b = std::max((int)check.size() - first, 1);
+					break;
+				}
+				if (f - first < 1)
+					continue;
+				bool fits = true;
+				for (int i = lo + 1; i < hi && fits; ++i) {
+					int s = f - first + childSymbol[i];
+					fits = s >= (int)check.size() || check[s] == -1;
+				}
+				if (fits) {
+					b = f - first;
+					break;
+				}
+			}
+			grow(b + childSymbol[hi - 1] + 1);
+			int slot = stateSlot[u];
+			base[slot] = b;
+			for (int i = lo; i < hi; ++i) {
+				int s = b + childSymbol[i];
+				take(s);
+				check[s] = slot;
+				stateSlot[childTarget[i]] = s;
+			}
+		}
+		int slots = (int)check.size();
+		slotFail.assign(slots, 0), slotDict.assign(slots, -1), slotKeyword.assign(slots, -1), slotState.assign(slots, -1);
+		for (int u = 0; u < n; ++u) {
+			int s = stateSlot[u];
+			slotFail[s] = stateSlot[fail[u]];
+			slotDict[s] = dictLink[u] == -1 ? -1 : stateSlot[dictLink[u]];
+			slotKeyword[s] = keywordAt[u];
+			slotState[s] = u;
+		}
+	}
+	void checkBuilt(bool want, const char *func) const {
+		if (built != want)
+			RE("[Error] AhoCorasick::%s : %s", func, want ? "Call build() first." : "Already built.");
+	}
+public:
+	AhoCorasick(const Alphabet &alph) : sig(alph), built(false), n(0) {
+		if (alph.empty())
+			RE("[Error] AhoCorasick : Provided alphabet is empty.");
+		firstChild.assign(1, -1), nextSibling.assign(1, -1), symbolOf.assign(1, -1), keywordAt.assign(1, -1);
+		rootChild.assign(sig.size(), -1);
+	}
+	const Alphabet &alphabet() const {
+		return sig;
+	}
+	// returns the keyword id, the empty keyword matches at every position
+	int addKeyword(const std::string &keyword) {
+		checkBuilt(false, "addKeyword");
+		int u = 0;
+		for (char ch : keyword) {
+			int c = sig.c2i((int)ch), v;
+			if (u == 0)
+				v = rootChild[c];
+			else
+				for (v = firstChild[u]; v != -1 && symbolOf[v] != c; v = nextSibling[v]) ;
+			if (v == -1) {
+				v = (int)firstChild.size();
+				firstChild.push_back(-1), symbolOf.push_back(c), keywordAt.push_back(-1);
+				if (u == 0) {
+					nextSibling.push_back(-1);
+					rootChild[c] = v;
+				}
+				else {
+					nextSibling.push_back(firstChild[u]);
+					firstChild[u] = v;
+				}
+			}
+			u = v;
+		}
+		int id = (int)keywordLength.size();
+		keywordLength.push_back((int)keyword.length());
+		nextKeyword.push_back(keywordAt[u]);
+		keywordAt[u] = id;
+		return id;
+	}
+	void build() {
+		checkBuilt(false, "build");
+		renumber();
+		failureLinks();
+		doubleArray();
+		built = true;
+	}
+	int keywords() const {
+		return (int)keywordLength.size();
+	}
+	int keywordSize(int keyword) const {
+		if (keyword < 0 || keyword >= keywords())
+			RE("[Error] AhoCorasick::keywordSize : Invalid keyword id (%d) violates the range [0, %d].", keyword, keywords() - 1);
+		return keywordLength[keyword];
+	}
+	int size() const {
+		checkBuilt(true, "size");
+		return n;
+	}
+	// ids of the keywords which end at the end of the text read to reach state, longest first
+	std::vector<int> matches(int state) const {
+		checkBuilt(true, "matches");
+		if (state < 0 || state >= n)
+			RE("[Error] AhoCorasick::matches : Invalid state internal index (%d) violates the range [0, %d].", state, n - 1);
+		std::vector<int> ret;
+		for (int u = keywordAt[state] != -1 ? state : dictLink[state]; u != -1; u = dictLink[u])
+			for (int k = keywordAt[u]; k != -1; k = nextKeyword[k])
+				ret.push_back(k);
+		return ret;
+	}
+	// complete automaton, in sparse range mode or with compressed alphabet columns, whichever is smaller: state u on symbol c goes to the longest suffix of (u's text + c) in the trie,
+	// a state accepts when some keyword ends there, so the text read so far ends with a keyword
+	DeterministicFiniteAutomaton toDFA() const {
+		checkBuilt(true, "toDFA");
+		struct Range {
+			int lo, hi, to;
+		};
+		int m = sig.size();
+		// every row repeats the root's targets, so the columns are the keyword symbols, one each, and one for all the others
+		std::vector<int> classOf(m, -1);
+		int classes = 0, others = -1;
+		{
+			std::vector<unsigned char> used(m, 0u);
+			for (int symbId : childSymbol)
+				used[symbId] = 1u;
+			for (int j = 0; j < m; ++j)
+				if (used[j])
+					classOf[j] = classes++;
+				else {
+					if (others == -1)
+						others = classes++;
+					classOf[j] = others;
+				}
+		}
+		// a row has at most the ranges of its failure row and two more around each child
+		size_t ranges = 0;
+		{
+			std::vector<int> bound(n);
+			for (int u = 0; u < n; ++u) {
+				bound[u] = (u == 0 ? 1 : bound[fail[u]]) + 2 * (childBegin[u + 1] - childBegin[u]);
+				ranges += bound[u];
+			}
+		}
+		std::pair<size_t, size_t> bytes = DeterministicFiniteAutomaton::layoutBytes(n, m, classes, ranges);
+		bool dense = bytes.first < bytes.second;
+		// the row of u is the row of its failure state with the children of u laid over it, and the root's default is itself,
+		// failure states come first in breadth first order so a row is dropped once its last dependant is written
+		std::vector<int> lastUse(n, -1);
+		for (int u = 1; u < n; ++u)
+			lastUse[fail[u]] = u;
+		DeterministicFiniteAutomaton ret(sig);
+		if (dense) {
+			ret.setSize(n);
+			ret.setSymbolClasses(classOf);
+			std::vector<std::vector<int>> rows(n);
+			std::vector<int> edges;
+			for (int u = 0; u < n; ++u) {
+				std::vector<int> row = u == 0 ? std::vector<int>(classes, 0) : rows[fail[u]];
+				for (int i = childBegin[u]; i < childBegin[u + 1]; ++i)
+					row[classOf[childSymbol[i]]] = childTarget[i];
+				for (int c = 0; c < classes; ++c)
+					edges.push_back(u), edges.push_back(c), edges.push_back(row[c]);
+				if (edges.size() >= (size_t)1 << 16 || u == n - 1) {
+					ret.setColumnTransitions(edges.data(), edges.size() / 3);
+					edges.clear();
+				}
+				if (u != 0 && lastUse[fail[u]] == u)
+					std::vector<int>().swap(rows[fail[u]]);
+				if (lastUse[u] != -1)
+					rows[u].swap(row);
+			}
+		}
+		else {
+			// ids whose symbols follow each other, so that setTransitionRange can take them at once
+			std::vector<int> runEnd(m);
+			for (int j = m - 1; j >= 0; --j)
+				runEnd[j] = j + 1 < m && sig.i2c(j + 1) == sig.i2c(j) + 1 ? runEnd[j + 1] : j;
+			ret.useSparseTransitions();
+			ret.setSize(n);
+			std::vector<std::vector<Range>> rows(n);
+			std::vector<Range> row;
+			auto push = [&row](int lo, int hi, int to) {
+				if (!row.empty() && row.back().to == to && row.back().hi + 1 == lo)
+					row.back().hi = hi;
+				else
+					row.push_back({lo, hi, to});
+			};
+			for (int u = 0; u < n; ++u) {
+				row.clear();
+				int i = childBegin[u], end = childBegin[u + 1], next = 0;
+				if (u == 0) {
+					for (; i < end; ++i) {
+						if (next < childSymbol[i])
+							push(next, childSymbol[i] - 1, 0);
+						push(childSymbol[i], childSymbol[i], childTarget[i]);
+						next = childSymbol[i] + 1;
+					}
+					if (next < m)
+						push(next, m - 1, 0);
+				}
+				else
+					for (const Range &r : rows[fail[u]])
+						for (int lo = r.lo; lo <= r.hi; ) {
+							while (i < end && childSymbol[i] < lo)
+								++i;
+							if (i < end && childSymbol[i] == lo) {
+								push(lo, lo, childTarget[i]);
+								++lo;
+								continue;
+							}
+							int hi = i < end ? std::min(r.hi, childSymbol[i] - 1) : r.hi;
+							push(lo, hi, r.to);
+							lo = hi + 1;
+						}
+				for (const Range &r : row)
+					for (int lo = r.lo; lo <= r.hi; ) {
+						int hi = std::min(r.hi, runEnd[lo]);
+						ret.setTransitionRange(ret[u], sig.i2c(lo), sig.i2c(hi), ret[r.to]);
+						lo = hi + 1;
+					}
+				if (u != 0 && lastUse[fail[u]] == u)
+					std::vector<Range>().swap(rows[fail[u]]);
+				if (lastUse[u] != -1)
+					rows[u] = row;
+			}
+		}
+		for (int u = 0; u < n; ++u)
+			if (keywordAt[u] != -1 || dictLink[u] != -1)
+				ret.flipStateAcceptance(ret[u]);
+		ret.setStartState(ret[0]);
+		return ret;
+	}
+	// number of slots in the double array, at least the number of states
+	int slots() const {
+		checkBuilt(true, "slots");
+		return (int)check.size();
+	}
+	size_t bytes() const {
+		return check.size() * sizeof(int) * 6;
+	}
+	// one step of the double array from a slot, failure links are followed on a miss,
+	// symbols out of the alphabet lead back to the root
+	int step(int slot, int c) const {
+		int symbId = sig.lookup(c);
+		if (symbId < 0 || symbId >= sig.size())
+			return 0;
+		for (;;) {
+			int t = base[slot] + symbId;
+			if (base[slot] > 0 && t < (int)check.size() && check[t] == slot)
+				return t;
+			if (slot == 0)
+				return 0;
+			slot = slotFail[slot];
+		}
+	}
+	// state number of a slot, the same as in toDFA
+	int slotToState(int slot) const {
+		return slotState[slot];
+	}
+	// f(keyword, end) for every occurrence of a keyword in [first, last), end is the offset just past it,
+	// occurrences are reported in order of their end, longer ones first
+	template <typename F>
+	void search(const char *first, const char *last, F f) const {
+		checkBuilt(true, "search");
+		// the empty keyword also ends before the first symbol
+		for (int k = slotKeyword[0]; k != -1; k = nextKeyword[k])
+			f(k, (size_t)0);
+		int slot = 0;
+		for (const char *p = first; p != last; ++p) {
+			slot = step(slot, (int)*p);
+			for (int s = slotKeyword[slot] != -1 ? slot : slotDict[slot]; s != -1; s = slotDict[s])
+				for (int k = slotKeyword[s]; k != -1; k = nextKeyword[k])
+					f(k, (size_t)(p - first + 1));
+		}
+	}
+	template <typename F>
+	void search(const std::string &text, F f) const {
+		search(text.data(), text.data() + text.length(), f);
+	}
+	~AhoCorasick() = default;
+};
+
+#undef RE
+
+#endif
@@ -0,0 +1,260 @@
+// PinkRabbit
+// 2026-10-16
+// Ahead-of-time C++ code generation for a DeterministicFiniteAutomaton, one label per state
+
+#ifndef CODEGEN_H__PINKRABBIT
+#define CODEGEN_H__PINKRABBIT
+
+#include "DFA.h"
+#include <sstream>
+
+#define RE(...) void(), std::fprintf(stderr, __VA_ARGS__), std::exit(23), void()
+#define WARN(...) void(), std::fprintf(stderr, __VA_ARGS__), void()
+
+// writes a standalone C++ source defining
+//     bool functionName(const char *first, const char *last);
+// which tells whether the automaton accepts [first, last) from its start state
+// states are direct-coded: a label per reachable state and a switch on the next byte,
+// self-loops become scan loops (memchr when a single byte leaves the state),
+// states which cannot reach an accept state are folded into return false, as are bytes out of the alphabet
+// symbols are matched as bytes: s and s & 0xFF name the same byte, symbols out of [-128, 255] are never read
+class CodeGenerator {
+	const DeterministicFiniteAutomaton &dfa;
+	int n;
+	int classes;
+	std::vector<int> byteClass; // class of every byte among the alphabet's columns, -1 for bytes out of the alphabet
+	std::vector<int> classSize; // bytes in every class
+	std::vector<int> next; // next[u * classes + c], target of state u on the bytes of class c, -1 if none
+	std::vector<unsigned char> live;
+	std::vector<int> label; // label number of every emitted state, -1 for the others
+	std::vector<int> order;
+	std::vector<unsigned char> hasPredecessor; // some other emitted state jumps to it
+	static std::string byteLiteral(int b) {
+		if (b < 128 && isgraph(b) && b != '\'' && b != '\\')
+			return std::string("\'") + (char)b + "\'";
+		return std::to_string(b);
+	}
+	int target(int u, int b) const {
+		return byteClass[b] == -1 ? -1 : next[(size_t)u * classes + byteClass[b]];
+	}
+	void build() {
+		int m = dfa.alphabetSize();
+		std::vector<int> byteSymbol(256, 0);
+		std::vector<unsigned char> present(256, 0u);
+		bool skipped = false;
+		for (int j = 0; j < m; ++j) {
+			int c = dfa.alphabet().i2c(j);
+			if (c < -128 || c > 255) {
+				skipped = true;
+				continue;
+			}
+			if (present[c & 0xFF])
+				RE("[Error] CodeGenerator : Symbols %d and %d are the same byte.", byteSymbol[c & 0xFF], c);
+			byteSymbol[c & 0xFF] = c;
+			present[c & 0xFF] = 1u;
+		}
+		if (skipped)
+			WARN("[Warning] CodeGenerator : Symbols out of [-128, 255] are left out.\n");
+		// bytes whose symbols share an alphabet class share a column, read once per state from a symbol of the class
+		std::vector<int> symbolClass = dfa.symbolClasses(), local(m, -1), represent;
+		byteClass.assign(256, -1);
+		classSize.clear();
+		for (int b = 0; b < 256; ++b) {
+			if (!present[b])
+				continue;
+			int &c = local[symbolClass[dfa.alphabet().c2i(byteSymbol[b])]];
+			if (c == -1) {
+				c = (int)represent.size();
+				represent.push_back(byteSymbol[b]);
+				classSize.push_back(0);
+			}
+			byteClass[b] = c;
+			++classSize[c];
+		}
+		classes = (int)represent.size();
+		next.assign((size_t)n * classes, -1);
+		for (int u = 0; u < n; ++u)
+			for (int c = 0; c < classes; ++c)
+				next[(size_t)u * classes + c] = dfa[u].transition(represent[c]).index();
+		// live states can still reach an accept state, found backwards from the accept states
+		std::vector<int> invBegin(n + 1, 0), invSrc, que;
+		for (int v : next)
+			if (v != -1)
+				++invBegin[v + 1];
+		for (int v = 0; v < n; ++v)
+			invBegin[v + 1] += invBegin[v];
+		invSrc.resize(invBegin[n]);
+		{
+			std::vector<int> pos(invBegin.begin(), invBegin.end() - 1);
+			for (size_t i = 0; i < next.size(); ++i)
+				if (next[i] != -1)
+					invSrc[pos[next[i]]++] = (int)(i / classes);
+		}
+		live.assign(n, 0u);
+		for (int u = 0; u < n; ++u)
+			if ((live[u] = dfa[u].accept()))
+				que.push_back(u);
+		for (size_t h = 0; h < que.size(); ++h)
+			for (int i = invBegin[que[h]]; i < invBegin[que[h] + 1]; ++i)
+				if (!live[invSrc[i]]) {
+					live[invSrc[i]] = 1u;
+					que.push_back(invSrc[i]);
+				}
+		// labels in breadth first order from the start state, dead targets are dropped
+		for (int &v : next)
+			if (v != -1 && !live[v])
+				v = -1;
+		label.assign(n, -1);
+		int s = dfa.start().index();
+		if (!live[s])
+			return ;
+		label[s] = 0;
+		order.push_back(s);
+		// in order of the first byte of every class, as the bytes were visited one by one
+		for (size_t h = 0; h < order.size(); ++h)
+			for (int c = 0; c < classes; ++c) {
+				int v = next[(size_t)order[h] * classes + c];
+				if (v != -1 && label[v] == -1) {
+					label[v] = (int)order.size();
+					order.push_back(v);
+				}
+			}
+		hasPredecessor.assign(n, 0u);
+		for (int w : order)
+			for (int c = 0; c < classes; ++c) {
+				int v = next[(size_t)w * classes + c];
+				if (v != -1 && v != w)
+					hasPredecessor[v] = 1u;
+			}
+	}
+	void emitState(std::ostream &out, int u, const std::string &prefix) const {
+		int id = label[u];
+		std::vector<int> exits;
+		bool loops = false;
+		for (int b = 0; b < 256; ++b) {
+			if (target(u, b) == u)
+				loops = true;
+			else
+				exits.push_back(b);
+		}
+		if (id != 0 || hasPredecessor[u])
+			out << "s" << id << ":\n"; // the start state is emitted first and may have no jumps to it
+		if (loops) {
+			if (exits.empty())
+				out << "\tp = end;\n";
+			else if (exits.size() == 1) {
+				out << "\tp = (const unsigned char *)std::memchr(p, " << exits[0] << ", (size_t)(end - p));\n";
+				out << "\tif (!p)\n\t\tp = end;\n";
+			}
+			else if (exits.size() <= 3) {
+				out << "\twhile (p != end";
+				for (int b : exits)
+					out << " && *p != " << byteLiteral(b);
+				out << ")\n\t\t++p;\n";
+			}
+			else
+				out << "\twhile (p != end && " << prefix << "loop" << id << "[*p])\n\t\t++p;\n";
+		}
+		out << "\tif (p == end)\n\t\treturn " << (dfa[u].accept() ? "true" : "false") << ";\n";
+		// bytes grouped by target, in order of their first byte
+		std::vector<int> targets;
+		for (int b = 0; b < 256; ++b) {
+			int v = target(u, b);
+			if (v != -1 && std::find(targets.begin(), targets.end(), v) == targets.end())
+				targets.push_back(v);
+		}
+		if (targets.empty()) {
+			out << "\treturn false;\n";
+			return ;
+		}
+		if (loops && targets.size() == 1) {
+			out << "\treturn false;\n"; // the scan stopped at a byte without a transition
+			return ;
+		}
+		out << "\tswitch (*p++) {\n";
+		for (int v : targets) {
+			if (v == u)
+				continue; // the scan loop never stops on these bytes
+			out << "\t";
+			int inLine = 0;
+			for (int b = 0; b < 256; ++b)
+				if (target(u, b) == v) {
+					if (inLine == 8) {
+						out << "\n\t";
+						inLine = 0;
+					}
+					out << (inLine ? " " : "") << "case " << byteLiteral(b) << ":";
+					++inLine;
+				}
+			out << "\n\t\tgoto s" << label[v] << ";\n";
+		}
+		out << "\tdefault:\n\t\treturn false;\n\t}\n";
+	}
+public:
+	CodeGenerator(const DeterministicFiniteAutomaton &automaton) : dfa(automaton), n(automaton.size()), classes(0) {
+		if (dfa.empty())
+			RE("[Error] CodeGenerator : Empty automaton.");
+		if (dfa.alphabetEmpty())
+			RE("[Error] CodeGenerator : Empty alphabet.");
+		if (!dfa.start().valid())
+			RE("[Error] CodeGenerator : Start state unset.");
+		build();
+	}
+	// number of states which get a label
+	int states() const {
+		return (int)order.size();
+	}
+	void generate(std::ostream &out, const std::string &functionName = "match") const {
+		std::string prefix = functionName + "_";
+		out << "// generated from a deterministic finite automaton with " << n << " states, "
+			<< order.size() << " of them are direct-coded\n";
+		out << "#include <cstddef>\n#include <cstring>\n\n";
+		bool tables = false;
+		for (int u : order) {
+			int exits = 256;
+			for (int c = 0; c < classes; ++c)
+				if (next[(size_t)u * classes + c] == u)
+					exits -= classSize[c];
+			bool loops = exits < 256;
+			if (!loops || exits <= 3)
+				continue;
+			if (!tables)
+				out << "namespace {\n";
+			tables = true;
+			out << "const bool " << prefix << "loop" << label[u] << "[256] = {";
+			for (int b = 0; b < 256; ++b)
+				out << (b % 32 ? "" : "\n\t") << (target(u, b) == u ? 1 : 0) << (b == 255 ? "" : ",");
+			out << "\n};\n";
+		}
+		if (tables)
+			out << "}\n\n";
+		out << "bool " << functionName << "(const char *first, const char *last) {\n";
+		out << "\tconst unsigned char *p = (const unsigned char *)first, *end = (const unsigned char *)last;\n";
+		if (order.empty()) {
+			out << "\t(void)p, (void)end;\n\treturn false;\n}\n";
+			return ;
+		}
+		for (int u : order)
+			emitState(out, u, prefix);
+		out << "}\n";
+	}
+	void generate(const std::string &path, const std::string &functionName = "match") const {
+		std::ofstream out(path);
+		if (!out)
+			RE("[Error] CodeGenerator::generate : Cannot open file \'%s\'.", path.c_str());
+		generate(out, functionName);
+		if (!out)
+			RE("[Error] CodeGenerator::generate : Cannot write file \'%s\'.", path.c_str());
+	}
+	std::string source(const std::string &functionName = "match") const {
+		std::ostringstream out;
+		generate(out, functionName);
+		return out.str();
+	}
+	~CodeGenerator() = default;
+};
+
+#undef RE
+#undef WARN
+
+#endif
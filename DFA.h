@@ -9,12 +9,35 @@
 #include <cstdlib>
 #include <cctype>
 #include <cstring>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
 #include <string>
 #include <algorithm>
 #include <functional>
+#include <memory>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+#if defined(__AVX2__) && defined(DFA_BATCH_GATHER)
+#include <immintrin.h>
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 #define RE(...) void(), std::fprintf(stderr, __VA_ARGS__), std::exit(23), void()
 #define WARN(...) void(), std::fprintf(stderr, __VA_ARGS__), void()
@@ -28,12 +51,40 @@ std::string symbolize(int x) {
 class Alphabet {
 	int siz;
 	std::function<int(int)> func, inv;
+	// dense symbol -> id table over [lutLow, lutLow + lutSize), -1 for symbols out of the alphabet
+	// shared between copies, symbols outside the range fall back to inv
+	std::shared_ptr<const std::vector<int>> lut;
+	const int *lutData;
+	int lutLow;
+	unsigned lutSize;
+	static const int maxTableSize = 1 << 16;
+	void compile() {
+		lut.reset();
+		lutData = nullptr, lutLow = 0, lutSize = 0u;
+		if (siz <= 0 || siz > maxTableSize)
+			return ;
+		long long lo = func(0), hi = lo;
+		for (int id = 1; id < siz; ++id) {
+			long long c = func(id);
+			lo = std::min(lo, c), hi = std::max(hi, c);
+		}
+		if (hi - lo + 1 > maxTableSize)
+			return ;
+		std::shared_ptr<std::vector<int>> table = std::make_shared<std::vector<int>>(hi - lo + 1);
+		for (long long c = lo; c <= hi; ++c) {
+			int id = inv((int)c);
+			(*table)[c - lo] = id >= 0 && id < siz ? id : -1;
+		}
+		lut = table;
+		lutData = table->data(), lutLow = (int)lo, lutSize = (unsigned)table->size();
+	}
 public:
-	Alphabet() : siz(0) {}
+	Alphabet() : siz(0), lutData(nullptr), lutLow(0), lutSize(0u) {}
 	Alphabet(int s, std::function<int(int)> fun, std::function<int(int)> invfun)
 		: siz(s), func(fun), inv(invfun) {
 		if (s <= 0)
 			RE("[Error] Alphabet : Provided size (%d) is a non-positive integer.", siz);
+		compile();
 	}
 	Alphabet(const Alphabet &) = default;
 	Alphabet(Alphabet &&) = default;
@@ -43,11 +94,13 @@ public:
 		if (s <= 0)
 			RE("[Error] Alphabet::reset : Provided size (%d) is a non-positive integer.", siz);
 		siz = s, func = fun, inv = invfun;
+		compile();
 	}
 	void clear() {
 		siz = 0;
 		func = std::function<int(int)>();
 		inv = std::function<int(int)>();
+		compile();
 	}
 	bool empty() const {
 		return siz == 0;
@@ -55,13 +108,32 @@ public:
 	int size() const {
 		return siz;
 	}
+	bool compiled() const {
+		return lutData != nullptr;
+	}
+	int tableLow() const {
+		return lutLow;
+	}
+	int tableSize() const {
+		return (int)lutSize;
+	}
+	const int *table() const {
+		return lutData;
+	}
 	int i2c(int id) const {
 		if (id < 0 || id >= siz)
 			RE("[Error] Alphabet::i2c : Invalid symbol id (%d) violates the range [0, %d].", id, siz - 1);
 		return func(id);
 	}
+	// symbol id without the range check, not necessarily in [0, size) for symbols out of the alphabet
+	int lookup(int c) const {
+		unsigned k = (unsigned)c - (unsigned)lutLow;
+		if (k < lutSize)
+			return lutData[k];
+		return inv(c);
+	}
 	int c2i(int c) const {
-		int id = inv(c);
+		int id = lookup(c);
 		if (id < 0 || id >= siz)
 			RE("[Error] Alphabet::c2i : Invalid symbol \'%s\' is not in the alphabet.", symbolize(c).c_str());
 		return id;
@@ -72,19 +144,201 @@ public:
 	~Alphabet() = default;
 };
 
+// one contiguous row-major table of n * m entries
+// the entry type is the narrowest of uint8/uint16/uint32 that can hold every state index,
+// the maximal value of the entry type stands for an empty transition
+class TransitionTable {
+	int n, m, w;
+	std::vector<uint8_t> t8;
+	std::vector<uint16_t> t16;
+	std::vector<uint32_t> t32;
+public:
+	TransitionTable() : n(0), m(0), w(0) {}
+	TransitionTable(const TransitionTable &) = default;
+	TransitionTable(TransitionTable &&) = default;
+	TransitionTable &operator = (const TransitionTable &) = default;
+	TransitionTable &operator = (TransitionTable &&) = default;
+	static int widthFor(int rows) {
+		if (rows <= 0xFF)
+			return 1;
+		if (rows <= 0xFFFF)
+			return 2;
+		return 4;
+	}
+	void reset(int rows, int cols) {
+		clear();
+		n = rows, m = cols, w = widthFor(rows);
+		size_t total = (size_t)n * m;
+		// narrow tables get a few bytes of slack so that 32-bit gathers of the last entry stay in bounds
+		if (w == 1)
+			t8.assign(total + 3, (uint8_t)0xFFu);
+		else if (w == 2)
+			t16.assign(total + 1, (uint16_t)0xFFFFu);
+		else
+			t32.assign(total, (uint32_t)0xFFFFFFFFu);
+	}
+	// keeps the first rows in place, or moves them to a narrower entry type if that fits them now
+	void truncate(int rows) {
+		if (widthFor(rows) != w) {
+			TransitionTable t;
+			t.reset(rows, m);
+			for (int u = 0; u < rows; ++u)
+				for (int j = 0; j < m; ++j)
+					t.set(u, j, get(u, j));
+			*this = std::move(t);
+			return ;
+		}
+		n = rows;
+		size_t total = (size_t)n * m;
+		if (w == 1)
+			t8.resize(total + 3), std::fill(t8.begin() + total, t8.end(), (uint8_t)0xFFu);
+		else if (w == 2)
+			t16.resize(total + 1), t16[total] = (uint16_t)0xFFFFu;
+		else
+			t32.resize(total);
+	}
+	void clear() {
+		n = m = w = 0;
+		std::vector<uint8_t>().swap(t8);
+		std::vector<uint16_t>().swap(t16);
+		std::vector<uint32_t>().swap(t32);
+	}
+	int rows() const {
+		return n;
+	}
+	int cols() const {
+		return m;
+	}
+	int width() const {
+		return w;
+	}
+	size_t bytes() const {
+		return (size_t)n * m * w;
+	}
+	int get(int u, int j) const {
+		size_t k = (size_t)u * m + j;
+		if (w == 1)
+			return t8[k] == 0xFFu ? -1 : (int)t8[k];
+		if (w == 2)
+			return t16[k] == 0xFFFFu ? -1 : (int)t16[k];
+		return t32[k] == 0xFFFFFFFFu ? -1 : (int)t32[k];
+	}
+	void set(int u, int j, int v) {
+		size_t k = (size_t)u * m + j;
+		if (w == 1)
+			t8[k] = (uint8_t)v;
+		else if (w == 2)
+			t16[k] = (uint16_t)v;
+		else
+			t32[k] = (uint32_t)v;
+	}
+	const uint8_t *data8() const {
+		return t8.data();
+	}
+	const uint16_t *data16() const {
+		return t16.data();
+	}
+	const uint32_t *data32() const {
+		return t32.data();
+	}
+	~TransitionTable() = default;
+};
+
+// counters of one minimization run, filled by the overloads of equivalenceClasses and minimize taking one
+// splitters are (class, symbol) pairs for Hopcroft's algorithm and new blocks or cords for Valmari and Lehtinen's,
+// marks count the states (and for the latter the transitions) moved to the front of their sets,
+// the phases are building the inverse transitions, refining the partition and numbering the classes
+struct MinimizationStats {
+	int states = 0, columns = 0, classes = 0;
+	unsigned long long splits = 0ull, splitterPushes = 0ull, marks = 0ull;
+	size_t peakSplitters = 0, scratchBytes = 0;
+	double inverseSeconds = 0.0, refineSeconds = 0.0, collectSeconds = 0.0;
+};
+
+// visit counts of profiled runs: visits[u] for state u, transitions[u * columns + c] for state u on
+// alphabet equivalence class c, columnOf[symbId] is the class of every symbol
+struct MatchProfile {
+	int columns = 0;
+	std::vector<int> columnOf;
+	std::vector<unsigned long long> visits, transitions;
+	unsigned long long runs = 0ull, symbols = 0ull, deadRuns = 0ull;
+	unsigned long long transitionCount(int u, int symbId) const {
+		return transitions[(size_t)u * columns + columnOf[symbId]];
+	}
+	// the k most visited states, most visited first
+	std::vector<int> hottest(int k) const {
+		std::vector<int> ret(visits.size());
+		for (size_t u = 0; u < ret.size(); ++u)
+			ret[u] = (int)u;
+		k = std::min(k, (int)ret.size());
+		std::partial_sort(ret.begin(), ret.begin() + k, ret.end(), [this](int a, int b) {
+			return visits[a] != visits[b] ? visits[a] > visits[b] : a < b;
+		});
+		ret.resize(k);
+		return ret;
+	}
+	void clear() {
+		*this = MatchProfile();
+	}
+};
+
+class DeterministicFiniteAutomatonView;
 class DeterministicFiniteAutomaton {
 private:
+	// symbol ids lo..hi all go to state to
+	struct SparseRange {
+		int lo, hi, to;
+	};
+	// names of merged states, joined with ", " only when they are asked for: state u came from the states
+	// sources[begin[u] .. begin[u + 1]) of an earlier automaton, or from sources[u] alone when oneToOne,
+	// named names[s] there (no names kept if all are empty), or else by the record before, or else q_s
+	struct MergedNames {
+		std::vector<int> begin, sources;
+		std::vector<std::string> names;
+		std::shared_ptr<const MergedNames> before;
+		bool oneToOne;
+		int size() const {
+			return oneToOne ? (int)sources.size() : (int)begin.size() - 1;
+		}
+		std::string sourceName(int s) const {
+			if (!names.empty() && !names[s].empty())
+				return names[s];
+			std::string ret = before ? before->name(s) : std::string();
+			return ret.empty() ? "q_" + std::to_string(s) : ret;
+		}
+		// empty for states added after the merge
+		std::string name(int u) const {
+			std::string ret;
+			if (u >= size())
+				return ret;
+			if (oneToOne)
+				return sourceName(sources[u]);
+			for (int i = begin[u]; i < begin[u + 1]; ++i) {
+				if (i != begin[u])
+					ret += ", ";
+				ret += sourceName(sources[i]);
+			}
+			return ret;
+		}
+	};
 	int n;
 	Alphabet sig;
 	std::vector<std::string> stateNames;
-	std::vector<std::vector<int>> transitions;
-	int countEmptyTransitions;
+	std::shared_ptr<const MergedNames> mergedNames;
+	TransitionTable transitions;
+	// column of the table for every symbol id once the alphabet is compressed, empty otherwise
+	std::vector<int> symbolClass;
+	// in sparse mode every row is a sorted list of disjoint ranges, symbols out of them have empty transitions
+	bool isSparse;
+	std::vector<std::vector<SparseRange>> sparseRows;
+	long long countEmptyTransitions;
 	bool isComplete;
 	int startStateIndex;
 	std::vector<unsigned char> acceptStates; // not to use std::vector<bool>
+	std::vector<int> acceptLabels; // token label of every state, only read for accept states, empty while all are 0
 public:
-	DeterministicFiniteAutomaton() : n(0), countEmptyTransitions(0), isComplete(false), startStateIndex(-1) {}
-	DeterministicFiniteAutomaton(const Alphabet &alph) : n(0), sig(alph), countEmptyTransitions(0), isComplete(false), startStateIndex(-1) {}
+	DeterministicFiniteAutomaton() : n(0), isSparse(false), countEmptyTransitions(0), isComplete(false), startStateIndex(-1) {}
+	DeterministicFiniteAutomaton(const Alphabet &alph) : n(0), sig(alph), isSparse(false), countEmptyTransitions(0), isComplete(false), startStateIndex(-1) {}
 	DeterministicFiniteAutomaton(const DeterministicFiniteAutomaton &) = default;
 	DeterministicFiniteAutomaton(DeterministicFiniteAutomaton &&) = default;
 	DeterministicFiniteAutomaton &operator = (const DeterministicFiniteAutomaton &) = default;
@@ -111,11 +365,16 @@ public:
 		n = 0;
 		sig.clear();
 		stateNames.clear();
+		mergedNames.reset();
 		transitions.clear();
+		symbolClass.clear();
+		isSparse = false;
+		sparseRows.clear();
 		countEmptyTransitions = 0;
 		isComplete = false;
 		startStateIndex = -1;
 		acceptStates.clear();
+		acceptLabels.clear();
 	}
 	void initTransitions() {
 		if (n == 0 && sig.empty())
@@ -125,13 +384,154 @@ public:
 		if (sig.empty())
 			RE("[Error] DFA::initTransitions : Empty alphabet but with some states.");
 		int m = sig.size();
+		symbolClass.clear();
+		if (isSparse) {
+			transitions.clear();
+			sparseRows.assign(n, std::vector<SparseRange>());
+		}
+		else {
+			sparseRows.clear();
+			transitions.reset(n, m);
+		}
+		countEmptyTransitions = (long long)n * m;
+		isComplete = false;
+	}
+	bool sparse() const {
+		return isSparse;
+	}
+	// number of columns of the dense table, smaller than the alphabet once it is compressed
+	int tableColumns() const {
+		return transitions.cols();
+	}
+	// switches to per-state sorted symbol ranges, meant for large alphabets where a state has few distinct targets,
+	// can be called before setSize so that the dense table is never allocated
+	void useSparseTransitions() {
+		if (isSparse)
+			return ;
+		if (!transitions.rows()) {
+			isSparse = true;
+			return ;
+		}
+		int m = sig.size();
+		std::vector<std::vector<SparseRange>> rows(n);
+		for (int u = 0; u < n; ++u)
+			for (int j = 0; j < m; ++j) {
+				int v = transitions.get(u, column(j));
+				if (v == -1)
+					continue;
+				if (!rows[u].empty() && rows[u].back().hi == j - 1 && rows[u].back().to == v)
+					++rows[u].back().hi;
+				else
+					rows[u].push_back({j, j, v});
+			}
 		transitions.clear();
-		transitions.resize(n);
-		for (int i = 0; i < n; ++i)
-			transitions[i].resize(m, -1);
-		countEmptyTransitions = n * m;
+		symbolClass.clear();
+		sparseRows.swap(rows);
+		isSparse = true;
+	}
+	void useDenseTransitions() {
+		if (!isSparse)
+			return ;
+		isSparse = false;
+		if (sparseRows.empty())
+			return ;
+		transitions.reset(n, sig.size());
+		for (int u = 0; u < n; ++u)
+			for (const SparseRange &r : sparseRows[u])
+				for (int j = r.lo; j <= r.hi; ++j)
+					transitions.set(u, j, r.to);
+		std::vector<std::vector<SparseRange>>().swap(sparseRows);
+	}
+	// alphabet equivalence classes: symbols which lead every state to the same target share a class,
+	// classes are numbered from 0 in order of their first symbol id
+	std::vector<int> symbolClasses() const {
+		std::vector<int> ret;
+		TransitionTable buffer;
+		classTable(buffer, ret);
+		std::vector<int> renumber(sig.size(), -1);
+		int cnt = 0;
+		for (int &x : ret) {
+			if (renumber[x] == -1)
+				renumber[x] = cnt++;
+			x = renumber[x];
+		}
+		return ret;
+	}
+	// keeps one column per alphabet equivalence class in the dense table, a sparse automaton is switched to it,
+	// setting a single transition afterwards restores the full table first
+	void compressAlphabet() {
+		if (isSparse ? sparseRows.empty() : !transitions.rows())
+			return ;
+		std::vector<int> classOf;
+		TransitionTable buffer;
+		const TransitionTable &tab = classTable(buffer, classOf);
+		if (&tab == &transitions)
+			return ;
+		transitions = std::move(buffer);
+		symbolClass.swap(classOf);
+		if (isSparse) {
+			isSparse = false;
+			std::vector<std::vector<SparseRange>>().swap(sparseRows);
+		}
+	}
+	void decompressAlphabet() {
+		if (symbolClass.empty())
+			return ;
+		int m = sig.size();
+		TransitionTable full;
+		full.reset(n, m);
+		for (int u = 0; u < n; ++u)
+			for (int j = 0; j < m; ++j)
+				full.set(u, j, transitions.get(u, symbolClass[j]));
+		transitions = std::move(full);
+		symbolClass.clear();
+	}
+	// dense table with one column per class from the start, for a builder which knows the classes of its automaton:
+	// classOf[j] is the column of symbol id j and every column has a symbol, the transitions set so far are dropped,
+	// setColumnTransitions then fills the compressed table directly
+	void setSymbolClasses(const std::vector<int> &classOf) {
+		if (n == 0)
+			RE("[Error] DFA::setSymbolClasses : Empty automaton.");
+		if (isSparse)
+			RE("[Error] DFA::setSymbolClasses : Sparse transitions have no columns.");
+		int m = sig.size();
+		if ((int)classOf.size() != m)
+			RE("[Error] DFA::setSymbolClasses : Class array size (%zu) does not match the alphabet size (%d).", classOf.size(), m);
+		int k = 0;
+		for (int j = 0; j < m; ++j) {
+			if (classOf[j] < 0 || classOf[j] >= m)
+				RE("[Error] DFA::setSymbolClasses : Invalid class (%d) of symbol id %d violates the range [0, %d].", classOf[j], j, m - 1);
+			k = std::max(k, classOf[j] + 1);
+		}
+		std::vector<unsigned char> seen(k, 0u);
+		bool identity = k == m;
+		for (int j = 0; j < m; ++j)
+			seen[classOf[j]] = 1u, identity = identity && classOf[j] == j;
+		if (std::count(seen.begin(), seen.end(), 0u))
+			RE("[Error] DFA::setSymbolClasses : Some class in [0, %d] has no symbol.", k - 1);
+		transitions.reset(n, k);
+		if (identity)
+			symbolClass.clear();
+		else
+			symbolClass = classOf;
+		countEmptyTransitions = (long long)n * m;
 		isComplete = false;
 	}
+	// bytes of the transitions of siz states over symbols symbols in either layout, counted as transitionBytes does,
+	// first a dense table of the given columns (with the class of every symbol when they are fewer), then sparse rows
+	// holding the given ranges in all, for builders which choose the layout from counts they already have
+	static std::pair<size_t, size_t> layoutBytes(int siz, int symbols, int columns, size_t ranges) {
+		size_t dense = (size_t)siz * columns * TransitionTable::widthFor(siz) + (columns < symbols ? (size_t)symbols * sizeof(int) : 0);
+		return std::make_pair(dense, (size_t)siz * sizeof(std::vector<SparseRange>) + ranges * sizeof(SparseRange));
+	}
+	size_t transitionBytes() const {
+		if (!isSparse)
+			return transitions.bytes() + symbolClass.size() * sizeof(int);
+		size_t ret = sparseRows.size() * sizeof(std::vector<SparseRange>);
+		for (const std::vector<SparseRange> &row : sparseRows)
+			ret += row.capacity() * sizeof(SparseRange);
+		return ret;
+	}
 	void setAlphabet(const Alphabet &alph) {
 		if (alph.empty())
 			RE("[Error] DFA::setAlphabet : Provided alphabet is empty.");
@@ -195,6 +595,7 @@ public:
 		State transition(const std::vector<int> &symbols) const;
 		State transition(const std::string &symbString) const;
 		bool accept() const;
+		int label() const;
 		~State() = default;
 	};
 	State getState(int indnum) const {
@@ -257,9 +658,10 @@ public:
 		int index = state.index();
 		if (index < 0 || index >= n)
 			RE("[Error] DFA::getStateName : Invalid state internal index (%d) violates the range [0, %d].", index, n - 1);
-		if (stateNames[index].empty())
+		std::string ret = explicitName(index);
+		if (ret.empty())
 			return "q_" + std::to_string(index);
-		return stateNames[index];
+		return ret;
 	}
 	void setTransition(const State &state1, int symbol, const State &state2) {
 		if (n == 0)
@@ -276,25 +678,102 @@ public:
 		int index1 = state1.index();
 		if (index1 < 0 || index1 >= n)
 			RE("[Error] DFA::setTransition : Invalid state1 internal index (%d) violates the range [0, %d].", index1, n - 1);
-		int &refIndex = transitions[index1][symbId];
 		if (!state2.valid()) {
-			if (refIndex != -1) {
-				if (countEmptyTransitions == 0)
-					isComplete = false;
-				++countEmptyTransitions;
-			}
-			refIndex = -1;
+			assignTransitions(index1, symbId, symbId, -1);
 			return ;
 		}
 		int index2 = state2.index();
 		if (index2 < 0 || index2 >= n)
 			RE("[Error] DFA::setTransition : Invalid state2 internal index (%d) violates the range [0, %d].", index2, n - 1);
-		if (refIndex == -1) {
-			--countEmptyTransitions;
-			if (countEmptyTransitions == 0)
-				isComplete = true;
+		assignTransitions(index1, symbId, symbId, index2);
+	}
+	// every symbol of symbolLo..symbolHi has to be in the alphabet with consecutive ids, checked symbol by symbol
+	void setTransitionRange(const State &state1, int symbolLo, int symbolHi, const State &state2) {
+		if (n == 0)
+			RE("[Error] DFA::setTransitionRange : Empty automaton.");
+		if (sig.empty())
+			RE("[Error] DFA::setTransitionRange : Empty alphabet");
+		if (this != &state1.DFA())
+			RE("[Error] DFA::setTransitionRange : State1\'s original automaton is not this one.");
+		if (this != &state2.DFA())
+			RE("[Error] DFA::setTransitionRange : State2\'s original automaton is not this one.");
+		int idLo = sig.c2i(symbolLo), idHi = sig.c2i(symbolHi);
+		bool consecutive = symbolLo <= symbolHi && idHi - idLo == symbolHi - symbolLo;
+		for (int k = 1; consecutive && k < idHi - idLo; ++k)
+			consecutive = sig.i2c(idLo + k) == symbolLo + k;
+		if (!consecutive)
+			RE("[Error] DFA::setTransitionRange : Symbols \'%s\' .. \'%s\' are not consecutive in the alphabet.", symbolize(symbolLo).c_str(), symbolize(symbolHi).c_str());
+		if (!state1.valid())
+			RE("[Error] DFA::setTransitionRange : State1 is invalid.");
+		int index1 = state1.index();
+		if (index1 < 0 || index1 >= n)
+			RE("[Error] DFA::setTransitionRange : Invalid state1 internal index (%d) violates the range [0, %d].", index1, n - 1);
+		int index2 = state2.valid() ? state2.index() : -1;
+		if (state2.valid() && (index2 < 0 || index2 >= n))
+			RE("[Error] DFA::setTransitionRange : Invalid state2 internal index (%d) violates the range [0, %d].", index2, n - 1);
+		assignTransitions(index1, idLo, idHi, index2);
+	}
+	// count transitions at once from a flat array of (state index, symbol, state index) triples,
+	// a last index of -1 empties the transition, every edge is checked and written in a single pass
+	// without building State objects, later edges win over earlier ones
+	void setTransitions(const int *edges, size_t count) {
+		if (n == 0)
+			RE("[Error] DFA::setTransitions : Empty automaton.");
+		if (sig.empty())
+			RE("[Error] DFA::setTransitions : Empty alphabet");
+		int m = sig.size();
+		if (!isSparse && !symbolClass.empty())
+			decompressAlphabet();
+		long long filled = 0, assigned = 0;
+		for (size_t k = 0; k < count; ++k, edges += 3) {
+			int u = edges[0], c = edges[1], v = edges[2];
+			if (u < 0 || u >= n)
+				RE("[Error] DFA::setTransitions : Invalid state1 internal index (%d) of edge %zu violates the range [0, %d].", u, k, n - 1);
+			if (v < -1 || v >= n)
+				RE("[Error] DFA::setTransitions : Invalid state2 internal index (%d) of edge %zu violates the range [-1, %d].", v, k, n - 1);
+			int symbId = sig.lookup(c);
+			if (symbId < 0 || symbId >= m)
+				RE("[Error] DFA::setTransitions : Invalid symbol \'%s\' of edge %zu is not in the alphabet.", symbolize(c).c_str(), k);
+			if (isSparse)
+				filled += sparseAssign(u, symbId, symbId, v);
+			else {
+				filled += transitions.get(u, symbId) != -1;
+				transitions.set(u, symbId, v);
+			}
+			assigned += v != -1;
+		}
+		countEmptyTransitions += filled - assigned;
+		isComplete = countEmptyTransitions == 0;
+	}
+	void setTransitions(const std::vector<int> &edges) {
+		if (edges.size() % 3 != 0)
+			RE("[Error] DFA::setTransitions : Edge array size (%zu) is not a multiple of 3.", edges.size());
+		setTransitions(edges.data(), edges.size() / 3);
+	}
+	// count transitions of whole columns of the dense table from (state index, column, state index) triples,
+	// checked and written like setTransitions without decompressing the alphabet
+	void setColumnTransitions(const int *edges, size_t count) {
+		if (n == 0)
+			RE("[Error] DFA::setColumnTransitions : Empty automaton.");
+		if (isSparse)
+			RE("[Error] DFA::setColumnTransitions : Sparse transitions have no columns.");
+		int k = transitions.cols();
+		std::vector<long long> filled(k, 0);
+		for (size_t e = 0; e < count; ++e, edges += 3) {
+			int u = edges[0], c = edges[1], v = edges[2];
+			if (u < 0 || u >= n)
+				RE("[Error] DFA::setColumnTransitions : Invalid state1 internal index (%d) of edge %zu violates the range [0, %d].", u, e, n - 1);
+			if (v < -1 || v >= n)
+				RE("[Error] DFA::setColumnTransitions : Invalid state2 internal index (%d) of edge %zu violates the range [-1, %d].", v, e, n - 1);
+			if (c < 0 || c >= k)
+				RE("[Error] DFA::setColumnTransitions : Invalid column (%d) of edge %zu violates the range [0, %d].", c, e, k - 1);
+			filled[c] += (transitions.get(u, c) != -1) - (v != -1);
+			transitions.set(u, c, v);
 		}
-		refIndex = index2;
+		// every symbol of a column counts
+		for (int j = 0; j < sig.size(); ++j)
+			countEmptyTransitions += filled[column(j)];
+		isComplete = countEmptyTransitions == 0;
 	}
 	State transition(const State &state, int symbol) const {
 		if (n == 0)
@@ -309,7 +788,7 @@ public:
 		int index1 = state.index();
 		if (index1 < 0 || index1 >= n)
 			RE("[Error] DFA::transition : Invalid state internal index (%d) violates the range [0, %d].", index1, n - 1);
-		int index2 = transitions[index1][symbId];
+		int index2 = getTransition(index1, symbId);
 		if (index2 == -1)
 			return invalid();
 		return getState(index2);
@@ -321,27 +800,417 @@ public:
 			RE("[Error] DFA::transition : Empty alphabet");
 		if (this != &state.DFA())
 			RE("[Error] DFA::transition : State\'s original automaton is not this one.");
-		std::vector<int> symbIds(symbols.size());
-		for (int i = 0; i < (int)symbols.size(); ++i)
-			symbIds[i] = sig.c2i(symbols[i]);
-		if (!state.valid())
-			return invalid();
 		int index1 = state.index();
-		if (index1 < 0 || index1 >= n)
+		if (state.valid() && (index1 < 0 || index1 >= n))
 			RE("[Error] DFA::transition : Invalid state internal index (%d) violates the range [0, %d].", index1, n - 1);
-		int index2 = index1;
-		for (int symbId : symbIds) {
-			index2 = transitions[index2][symbId];
-			if (index2 == -1)
-				return invalid();
-		}
+		int index2 = runSymbols(index1, symbols.data(), symbols.data() + symbols.size());
+		if (index2 == -1)
+			return invalid();
 		return getState(index2);
 	}
 	State transition(const State &state, const std::string &symbString) const {
-		std::vector<int> symbols(symbString.length());
-		for (int i = 0; i < (int)symbString.length(); ++i)
-			symbols[i] = symbString[i];
-		return transition(state, symbols);
+		if (n == 0)
+			RE("[Error] DFA::transition : Empty automaton.");
+		if (sig.empty())
+			RE("[Error] DFA::transition : Empty alphabet");
+		if (this != &state.DFA())
+			RE("[Error] DFA::transition : State\'s original automaton is not this one.");
+		int index1 = state.index();
+		if (state.valid() && (index1 < 0 || index1 >= n))
+			RE("[Error] DFA::transition : Invalid state internal index (%d) violates the range [0, %d].", index1, n - 1);
+		int index2 = runSymbols(index1, symbString.data(), symbString.data() + symbString.length());
+		if (index2 == -1)
+			return invalid();
+		return getState(index2);
+	}
+	// resumable cursor consuming its input in pieces without copying it
+	class Matcher {
+		friend class DeterministicFiniteAutomaton;
+	private:
+		DeterministicFiniteAutomaton const *orig;
+		int ind;
+		unsigned long long cnt;
+	public:
+		Matcher(const DeterministicFiniteAutomaton &dfa);
+		Matcher(const State &state);
+		Matcher(const Matcher &) = default;
+		Matcher(Matcher &&) = default;
+		Matcher &operator = (const Matcher &) = default;
+		Matcher &operator = (Matcher &&) = default;
+		const DeterministicFiniteAutomaton &DFA() const {
+			return *orig;
+		}
+		void reset();
+		void reset(const State &state);
+		Matcher &feed(int symbol);
+		Matcher &feed(const char *first, const char *last);
+		Matcher &feed(const char *buffer, size_t length);
+		Matcher &feed(const std::string &symbString);
+#if __cplusplus >= 201703L
+		Matcher &feed(std::string_view symbString);
+#endif
+		Matcher &feed(std::istream &in);
+		Matcher &feedFile(const std::string &path);
+		bool dead() const {
+			return ind == -1;
+		}
+		bool accept() const;
+		int label() const;
+		State state() const;
+		int index() const {
+			return ind;
+		}
+		unsigned long long consumed() const {
+			return cnt;
+		}
+		~Matcher() = default;
+	};
+	Matcher matcher() const {
+		return Matcher(*this);
+	}
+	// runs [first, last) from the start state and counts the visits of every state and transition into prof,
+	// which adds up over calls on the same automaton, the other matching functions are not instrumented
+	void profile(const char *first, const char *last, MatchProfile &prof) const {
+		if (n == 0)
+			RE("[Error] DFA::profile : Empty automaton.");
+		if (sig.empty())
+			RE("[Error] DFA::profile : Empty alphabet");
+		if (startStateIndex == -1)
+			RE("[Error] DFA::profile : Start state unset.");
+		if (prof.visits.empty()) {
+			TransitionTable buffer;
+			prof.columns = classTable(buffer, prof.columnOf).cols();
+			prof.visits.assign(n, 0ull);
+			prof.transitions.assign((size_t)n * prof.columns, 0ull);
+		}
+		else if ((int)prof.visits.size() != n || (int)prof.columnOf.size() != sig.size())
+			RE("[Error] DFA::profile : The profile was taken on another automaton.");
+		++prof.runs;
+		prof.symbols += (unsigned long long)(last - first);
+		++prof.visits[startStateIndex];
+		int index;
+		if (isSparse)
+			index = runProfiled(SparseStepper(this), prof, first, last);
+		else if (transitions.width() == 1)
+			index = runProfiled(DenseStepper<uint8_t>(transitions.data8(), classData(), transitions.cols()), prof, first, last);
+		else if (transitions.width() == 2)
+			index = runProfiled(DenseStepper<uint16_t>(transitions.data16(), classData(), transitions.cols()), prof, first, last);
+		else
+			index = runProfiled(DenseStepper<uint32_t>(transitions.data32(), classData(), transitions.cols()), prof, first, last);
+		prof.deadRuns += index == -1;
+	}
+	void profile(const std::string &symbString, MatchProfile &prof) const {
+		profile(symbString.data(), symbString.data() + symbString.length(), prof);
+	}
+	// unanchored search over a byte buffer, built once by searcher() and independent of the automaton afterwards,
+	// finds every end of a substring in the language, or the leftmost-longest non-overlapping matches,
+	// byte b is read as the symbol (int)(char)b, bytes out of the alphabet end every match going through them
+	// states leaving themselves on at most three bytes are skipped over with a vectorized byte search
+	class Searcher {
+		friend class DeterministicFiniteAutomaton;
+	private:
+		// bytes leaving a state, count is -1 when there are more than three
+		struct Exits {
+			int count;
+			unsigned char bytes[3];
+		};
+		// columns are the alphabet equivalence classes, the last one is for bytes out of the alphabet
+		int cols;
+		int byteClass[256];
+		// automaton of (any symbol)* L, each state a set of live states of the automaton with its start state,
+		// state 0 is the start state alone, the table is complete
+		TransitionTable scanTable;
+		std::vector<unsigned char> scanAccept;
+		std::vector<Exits> scanExits; // accept states are never skipped over here, every position is an end
+		// the automaton itself without its dead states, for the longest match from a given position
+		TransitionTable anchoredTable;
+		std::vector<unsigned char> anchoredAccept;
+		std::vector<Exits> anchoredExits;
+		int anchoredStart;
+		Exits startExits; // bytes on which a nonempty match can begin
+		unsigned char startLive[256];
+		Searcher(const DeterministicFiniteAutomaton &dfa, int stateLimit);
+		void exitsOf(const TransitionTable &tab, const std::vector<std::vector<int>> &classBytes, std::vector<Exits> &exits) const;
+		static const char *skip(const char *p, const char *last, const Exits &e);
+		template <typename Stepper, typename F>
+		void scanEnds(const Stepper &step, const char *first, const char *last, F &f) const {
+			int s = 0;
+			if (scanAccept[s])
+				f((size_t)0);
+			for (const char *p = first; p != last; ) {
+				if (scanExits[s].count != -1) {
+					p = skip(p, last, scanExits[s]);
+					if (p == last)
+						break;
+				}
+				s = step(s, byteClass[(unsigned char)*p++]);
+				if (scanAccept[s])
+					f((size_t)(p - first));
+			}
+		}
+		template <typename Stepper>
+		const char *scanFirstEnd(const Stepper &step, const char *first, const char *last) const {
+			int s = 0;
+			if (scanAccept[s])
+				return first;
+			for (const char *p = first; p != last; ) {
+				if (scanExits[s].count != -1) {
+					p = skip(p, last, scanExits[s]);
+					if (p == last)
+						break;
+				}
+				s = step(s, byteClass[(unsigned char)*p++]);
+				if (scanAccept[s])
+					return p;
+			}
+			return nullptr;
+		}
+		template <typename Stepper>
+		const char *scanLongest(const Stepper &step, const char *first, const char *last) const {
+			int u = anchoredStart;
+			const char *ret = anchoredAccept[u] ? first : nullptr;
+			for (const char *p = first; p != last; ) {
+				if (anchoredExits[u].count != -1) {
+					p = skip(p, last, anchoredExits[u]);
+					if (anchoredAccept[u])
+						ret = p;
+					if (p == last)
+						break;
+				}
+				u = step(u, byteClass[(unsigned char)*p++]);
+				if (u == -1)
+					break;
+				if (anchoredAccept[u])
+					ret = p;
+			}
+			return ret;
+		}
+		// end of the earliest ending match in [first, last), nullptr if none
+		const char *firstEnd(const char *first, const char *last) const;
+		// end of the longest match starting at first, nullptr if none
+		const char *longest(const char *first, const char *last) const;
+	public:
+		Searcher(const Searcher &) = default;
+		Searcher(Searcher &&) = default;
+		Searcher &operator = (const Searcher &) = default;
+		Searcher &operator = (Searcher &&) = default;
+		// states of the scan automaton
+		int size() const {
+			return scanTable.rows();
+		}
+		// states of both automata which are skipped over with a byte search
+		int acceleratedStates() const;
+		// f(end) for every offset end such that some substring ending there is accepted, in increasing order
+		template <typename F>
+		void findEnds(const char *first, const char *last, F f) const {
+			if (scanTable.width() == 1)
+				return scanEnds(DenseStepper<uint8_t>(scanTable.data8(), nullptr, cols), first, last, f);
+			if (scanTable.width() == 2)
+				return scanEnds(DenseStepper<uint16_t>(scanTable.data16(), nullptr, cols), first, last, f);
+			return scanEnds(DenseStepper<uint32_t>(scanTable.data32(), nullptr, cols), first, last, f);
+		}
+		std::vector<size_t> findEnds(const std::string &text) const {
+			std::vector<size_t> ret;
+			findEnds(text.data(), text.data() + text.length(), [&ret](size_t end) { ret.push_back(end); });
+			return ret;
+		}
+		// f(begin, end) for the leftmost-longest matches from left to right, the next one is searched from end,
+		// or one byte later after an empty match
+		// runs from the candidate beginnings are tried in turn up to the earliest end, so it is quadratic at worst
+		template <typename F>
+		void findSpans(const char *first, const char *last, F f) const {
+			for (const char *pos = first; ; ) {
+				const char *e = firstEnd(pos, last), *s = pos, *end = nullptr;
+				if (!e)
+					return ;
+				for (; ; ++s) {
+					if (!anchoredAccept[anchoredStart]) {
+						if (startExits.count != -1)
+							s = skip(s, e, startExits);
+						else
+							while (!startLive[(unsigned char)*s])
+								++s;
+					}
+					if ((end = longest(s, last)))
+						break;
+				}
+				f((size_t)(s - first), (size_t)(end - first));
+				if (end != s)
+					pos = end;
+				else if (s != last)
+					pos = s + 1;
+				else
+					return ;
+			}
+		}
+		std::vector<std::pair<size_t, size_t>> findSpans(const std::string &text) const {
+			std::vector<std::pair<size_t, size_t>> ret;
+			findSpans(text.data(), text.data() + text.length(), [&ret](size_t begin, size_t end) { ret.emplace_back(begin, end); });
+			return ret;
+		}
+		bool contains(const char *first, const char *last) const {
+			return firstEnd(first, last) != nullptr;
+		}
+		bool contains(const std::string &text) const {
+			return contains(text.data(), text.data() + text.length());
+		}
+		~Searcher() = default;
+	};
+	// the scan automaton is built by subset construction, which fails with more than stateLimit states
+	Searcher searcher(int stateLimit = 1 << 22) const {
+		return Searcher(*this, stateLimit);
+	}
+	// maximal munch tokenizer over a byte buffer, built once by tokenizer() and independent of the automaton afterwards,
+	// every token is the longest nonempty prefix of the rest of the input that is accepted, with the label of its accept state,
+	// a byte where no token begins becomes a token of length one with label -1, byte b is read as the symbol (int)(char)b
+	// a run stops once no accept state can be reached, the bytes it read past the end of its token are read again
+	// for the next one, so it is linear unless a token can be followed far by prefixes of longer ones
+	class Tokenizer {
+		friend class DeterministicFiniteAutomaton;
+	private:
+		// columns are the alphabet equivalence classes, the last one is for bytes out of the alphabet
+		int cols;
+		int byteClass[256];
+		TransitionTable table; // the automaton without its dead states
+		std::vector<int> labels; // label of every state, -1 for the others
+		int start;
+		Tokenizer(const DeterministicFiniteAutomaton &dfa);
+		template <typename Stepper>
+		const char *scan(const Stepper &step, const char *first, const char *last, int &label) const {
+			const char *end = first + 1;
+			label = -1;
+			int u = start;
+			for (const char *p = first; p != last && u != -1; ) {
+				u = step(u, byteClass[(unsigned char)*p++]);
+				if (u != -1 && labels[u] != -1)
+					label = labels[u], end = p;
+			}
+			return end;
+		}
+		template <typename Stepper, typename F>
+		void scanAll(const Stepper &step, const char *first, const char *last, F &f) const {
+			int label;
+			for (const char *p = first; p != last; ) {
+				const char *end = scan(step, p, last, label);
+				f((size_t)(p - first), (size_t)(end - first), label);
+				p = end;
+			}
+		}
+	public:
+		struct Token {
+			size_t begin, end;
+			int label;
+		};
+		Tokenizer(const Tokenizer &) = default;
+		Tokenizer(Tokenizer &&) = default;
+		Tokenizer &operator = (const Tokenizer &) = default;
+		Tokenizer &operator = (Tokenizer &&) = default;
+		int size() const {
+			return table.rows();
+		}
+		// end of the token beginning at first < last, its label is stored in label
+		const char *next(const char *first, const char *last, int &label) const;
+		// f(begin, end, label) for every token of [first, last) from left to right, nothing is allocated
+		template <typename F>
+		void tokenize(const char *first, const char *last, F f) const {
+			if (table.width() == 1)
+				return scanAll(DenseStepper<uint8_t>(table.data8(), nullptr, cols), first, last, f);
+			if (table.width() == 2)
+				return scanAll(DenseStepper<uint16_t>(table.data16(), nullptr, cols), first, last, f);
+			return scanAll(DenseStepper<uint32_t>(table.data32(), nullptr, cols), first, last, f);
+		}
+		std::vector<Token> tokenize(const std::string &text) const {
+			std::vector<Token> ret;
+			tokenize(text.data(), text.data() + text.length(), [&ret](size_t begin, size_t end, int label) {
+				ret.push_back({begin, end, label});
+			});
+			return ret;
+		}
+		~Tokenizer() = default;
+	};
+	Tokenizer tokenizer() const {
+		return Tokenizer(*this);
+	}
+	// runs count independent inputs from the start state, several of them interleaved in lockstep
+	// so that their table loads overlap, finalStates[i] receives the final state index or -1
+	// define DFA_BATCH_GATHER on an AVX2 target to issue the loads as gathers instead
+	void transitionBatch(const char *const *inputs, const size_t *lengths, size_t count, int *finalStates) const {
+		if (n == 0)
+			RE("[Error] DFA::transitionBatch : Empty automaton.");
+		if (sig.empty())
+			RE("[Error] DFA::transitionBatch : Empty alphabet");
+#if defined(__AVX2__) && defined(DFA_BATCH_GATHER)
+		if (!isSparse && symbolClass.empty() && transitions.bytes() + 4 < (size_t)0x7FFFFFFF) {
+			if (transitions.width() == 1)
+				return runBatchGather((const char *)transitions.data8(), inputs, lengths, count, finalStates);
+			if (transitions.width() == 2)
+				return runBatchGather((const char *)transitions.data16(), inputs, lengths, count, finalStates);
+			return runBatchGather((const char *)transitions.data32(), inputs, lengths, count, finalStates);
+		}
+#endif
+		if (isSparse)
+			return runBatch(SparseStepper(this), inputs, lengths, count, finalStates);
+		if (transitions.width() == 1)
+			return runBatch(DenseStepper<uint8_t>(transitions.data8(), classData(), transitions.cols()), inputs, lengths, count, finalStates);
+		if (transitions.width() == 2)
+			return runBatch(DenseStepper<uint16_t>(transitions.data16(), classData(), transitions.cols()), inputs, lengths, count, finalStates);
+		return runBatch(DenseStepper<uint32_t>(transitions.data32(), classData(), transitions.cols()), inputs, lengths, count, finalStates);
+	}
+	std::vector<int> transitionBatch(const std::vector<std::string> &inputs) const {
+		std::vector<const char *> ptrs(inputs.size());
+		std::vector<size_t> lengths(inputs.size());
+		for (size_t i = 0; i < inputs.size(); ++i)
+			ptrs[i] = inputs[i].data(), lengths[i] = inputs[i].length();
+		std::vector<int> ret(inputs.size());
+		transitionBatch(ptrs.data(), lengths.data(), inputs.size(), ret.data());
+		return ret;
+	}
+	std::vector<unsigned char> acceptBatch(const std::vector<std::string> &inputs) const {
+		std::vector<int> finals = transitionBatch(inputs);
+		std::vector<unsigned char> ret(finals.size());
+		for (size_t i = 0; i < finals.size(); ++i)
+			ret[i] = finals[i] == -1 ? 0u : acceptStates[finals[i]];
+		return ret;
+	}
+	// data-parallel run of one long input: every chunk but the first is run from all states at once
+	// (runs that meet are merged, runs that die are dropped) to get its state-to-state mapping,
+	// the mappings are then composed in order, meant for small, e.g. minimized, automata
+	State transitionParallel(const State &state, const char *first, const char *last, int threads = 0) const {
+		if (n == 0)
+			RE("[Error] DFA::transitionParallel : Empty automaton.");
+		if (sig.empty())
+			RE("[Error] DFA::transitionParallel : Empty alphabet");
+		if (this != &state.DFA())
+			RE("[Error] DFA::transitionParallel : State\'s original automaton is not this one.");
+		if (threads <= 0)
+			threads = std::max(1, (int)std::thread::hardware_concurrency());
+		size_t length = (size_t)(last - first);
+		const size_t minChunk = (size_t)1 << 16;
+		if ((size_t)threads > length / minChunk)
+			threads = (int)std::max((size_t)1, length / minChunk);
+		int index = state.index();
+		if (threads == 1) {
+			index = runSymbols(index, first, last);
+			return index == -1 ? invalid() : getState(index);
+		}
+		std::vector<std::vector<int>> mappings(threads);
+		std::vector<std::thread> workers;
+		size_t step = length / threads;
+		for (int t = 1; t < threads; ++t) {
+			const char *lo = first + step * t, *hi = t + 1 == threads ? last : first + step * (t + 1);
+			workers.emplace_back([this, lo, hi, &mappings, t]() {
+				chunkMapping(lo, hi, mappings[t]);
+			});
+		}
+		index = runSymbols(index, first, first + step);
+		for (std::thread &worker : workers)
+			worker.join();
+		for (int t = 1; t < threads && index != -1; ++t)
+			index = mappings[t][index];
+		return index == -1 ? invalid() : getState(index);
+	}
+	State transitionParallel(const State &state, const std::string &symbString, int threads = 0) const {
+		return transitionParallel(state, symbString.data(), symbString.data() + symbString.length(), threads);
 	}
 	void clearAcceptStates(bool value = false) {
 		if (n == 0)
@@ -394,24 +1263,950 @@ public:
 			RE("[Error] DFA::isAcceptState : Invalid state internal index (%d) violates the range [0, %d].", index, n - 1);
 		return (bool)acceptStates[index];
 	}
+	// accept states carry token labels so that one automaton tells several kinds of words apart:
+	// minimization only merges states with the same label, and in the products a pair takes the smallest label
+	// of its accepting sides, so a lower label wins as an earlier rule does in lex,
+	// accept states have label 0 until one is set, the labels of the other states are kept but never read
+	void setAcceptLabel(const State &state, int label) {
+		if (n == 0)
+			RE("[Error] DFA::setAcceptLabel : Empty automaton.");
+		if (this != &state.DFA())
+			RE("[Error] DFA::setAcceptLabel : State\'s original automaton is not this one.");
+		if (!state.valid())
+			RE("[Error] DFA::setAcceptLabel : State is invalid.");
+		if (label < 0)
+			RE("[Error] DFA::setAcceptLabel : Provided label (%d) is negative.", label);
+		int index = state.index();
+		acceptStates[index] = 1u;
+		if (acceptLabels.empty() && label == 0)
+			return ;
+		if (acceptLabels.empty())
+			acceptLabels.assign(n, 0);
+		acceptLabels[index] = label;
+	}
+	// gives every accept state the same label, e.g. before the automata of several tokens are joined by unionWith
+	void labelAcceptStates(int label) {
+		if (label < 0)
+			RE("[Error] DFA::labelAcceptStates : Provided label (%d) is negative.", label);
+		if (label == 0)
+			std::vector<int>().swap(acceptLabels);
+		else
+			acceptLabels.assign(n, label);
+	}
+	// label of an accept state, -1 for the other states
+	int acceptLabel(const State &state) const {
+		if (n == 0)
+			RE("[Error] DFA::acceptLabel : Empty automaton.");
+		if (this != &state.DFA())
+			RE("[Error] DFA::acceptLabel : State\'s original automaton is not this one.");
+		if (!state.valid())
+			RE("[Error] DFA::acceptLabel : State is invalid.");
+		return labelOf(state.index());
+	}
+	bool labeled() const {
+		return !acceptLabels.empty();
+	}
 private:
-	// table filling algorithm with a queue to efficiently select pairs which distinguishable
-	// O(n^2 m), with n = #nodes, m = |alpabet|
-	// assuming DFA is complete
-	// discarded, use equivalenceClassesHopcroft for a better performance
-	// only for studying purpose
-	std::vector<int> equivalenceClassesTableFilling() const {
+	int labelOf(int u) const {
+		return !acceptStates[u] ? -1 : acceptLabels.empty() ? 0 : acceptLabels[u];
+	}
+	// initial classes of the minimization, states with the same label (-1 when rejecting) share one,
+	// numbered from 0 in order of appearance, returns their number
+	int labelGroups(std::vector<int> &groupOf) const {
+		groupOf.resize(n);
+		if (acceptLabels.empty()) {
+			int cnt = 1;
+			for (int u = 0; u < n; ++u)
+				if ((groupOf[u] = acceptStates[u] != acceptStates[0]))
+					cnt = 2;
+			return cnt;
+		}
+		std::unordered_map<int, int> ids;
+		for (int u = 0; u < n; ++u)
+			groupOf[u] = ids.emplace(labelOf(u), (int)ids.size()).first->second;
+		return (int)ids.size();
+	}
+	int column(int symbId) const {
+		return symbolClass.empty() ? symbId : symbolClass[symbId];
+	}
+	int sparseGet(int u, int symbId) const {
+		const std::vector<SparseRange> &row = sparseRows[u];
+		std::vector<SparseRange>::const_iterator it = std::upper_bound(row.begin(), row.end(), symbId,
+			[](int x, const SparseRange &r) { return x < r.lo; });
+		if (it == row.begin())
+			return -1;
+		--it;
+		return symbId <= it->hi ? it->to : -1;
+	}
+	int getTransition(int u, int symbId) const {
+		if (isSparse)
+			return sparseGet(u, symbId);
+		return transitions.get(u, column(symbId));
+	}
+	// f(v) for every non-empty transition target of state u, once per column or range
+	template <typename F>
+	void forEachTarget(int u, F f) const {
+		if (isSparse) {
+			for (const SparseRange &r : sparseRows[u])
+				f(r.to);
+			return ;
+		}
+		for (int c = 0; c < transitions.cols(); ++c) {
+			int v = transitions.get(u, c);
+			if (v != -1)
+				f(v);
+		}
+	}
+	// replaces symbols lo..hi of row u by target v, returns how many of them had a target before
+	long long sparseAssign(int u, int lo, int hi, int v) {
+		std::vector<SparseRange> &row = sparseRows[u];
+		size_t a = std::lower_bound(row.begin(), row.end(), lo,
+			[](const SparseRange &r, int x) { return r.hi < x; }) - row.begin();
+		size_t b = std::upper_bound(row.begin(), row.end(), hi,
+			[](int x, const SparseRange &r) { return x < r.lo; }) - row.begin();
+		long long filled = 0;
+		for (size_t i = a; i < b; ++i)
+			filled += std::min(hi, row[i].hi) - std::max(lo, row[i].lo) + 1;
+		// adjacent neighbours are taken in as well so that equal targets can be merged
+		if (a > 0 && row[a - 1].hi == lo - 1)
+			--a;
+		if (b < row.size() && row[b].lo == hi + 1)
+			++b;
+		SparseRange pieces[5];
+		int cnt = 0;
+		for (size_t i = a; i < b; ++i) {
+			if (row[i].lo < lo)
+				pieces[cnt++] = {row[i].lo, std::min(row[i].hi, lo - 1), row[i].to};
+			if (row[i].hi > hi)
+				pieces[cnt++] = {std::max(row[i].lo, hi + 1), row[i].hi, row[i].to};
+		}
+		if (v != -1)
+			pieces[cnt++] = {lo, hi, v};
+		for (int i = 1; i < cnt; ++i)
+			for (int j = i; j > 0 && pieces[j].lo < pieces[j - 1].lo; --j)
+				std::swap(pieces[j], pieces[j - 1]);
+		int merged = 0;
+		for (int i = 0; i < cnt; ++i) {
+			if (merged && pieces[merged - 1].to == pieces[i].to && pieces[merged - 1].hi + 1 == pieces[i].lo)
+				pieces[merged - 1].hi = pieces[i].hi;
+			else
+				pieces[merged++] = pieces[i];
+		}
+		row.erase(row.begin() + a, row.begin() + b);
+		row.insert(row.begin() + a, pieces, pieces + merged);
+		return filled;
+	}
+	void assignTransitions(int u, int lo, int hi, int v) {
+		long long filled = 0;
+		if (isSparse)
+			filled = sparseAssign(u, lo, hi, v);
+		else {
+			if (!symbolClass.empty())
+				decompressAlphabet();
+			for (int j = lo; j <= hi; ++j) {
+				filled += transitions.get(u, j) != -1;
+				transitions.set(u, j, v);
+			}
+		}
+		countEmptyTransitions += filled - (v == -1 ? 0 : hi - lo + 1);
+		isComplete = countEmptyTransitions == 0;
+	}
+	long long countEmptyEntries() const {
+		long long ret = 0;
 		int m = sig.size();
-		std::vector<std::vector<std::vector<int>>> invTr(n, std::vector<std::vector<int>>(m));
-		for (int i = 0; i < n; ++i)
+		if (isSparse) {
+			for (const std::vector<SparseRange> &row : sparseRows) {
+				ret += m;
+				for (const SparseRange &r : row)
+					ret -= r.hi - r.lo + 1;
+			}
+			return ret;
+		}
+		std::vector<long long> weight(transitions.cols(), 0);
+		for (int j = 0; j < m; ++j)
+			++weight[column(j)];
+		for (int u = 0; u < n; ++u)
+			for (int c = 0; c < transitions.cols(); ++c)
+				if (transitions.get(u, c) == -1)
+					ret += weight[c];
+		return ret;
+	}
+	// groups identical columns of a table, classes are numbered in order of their first column
+	static int identicalColumns(const TransitionTable &tab, std::vector<int> &colClass) {
+		int rows = tab.rows(), cols = tab.cols();
+		std::vector<uint64_t> hash(cols, 1469598103934665603ull);
+		for (int u = 0; u < rows; ++u)
+			for (int j = 0; j < cols; ++j)
+				hash[j] = (hash[j] ^ (uint64_t)(tab.get(u, j) + 1)) * 1099511628211ull;
+		std::vector<int> order(cols);
+		for (int j = 0; j < cols; ++j)
+			order[j] = j;
+		std::sort(order.begin(), order.end(), [&hash](int x, int y) { return hash[x] != hash[y] ? hash[x] < hash[y] : x < y; });
+		colClass.assign(cols, -1);
+		for (int i = 0; i < cols; ) {
+			int e = i;
+			while (e < cols && hash[order[e]] == hash[order[i]])
+				++e;
+			for (int x = i; x < e; ++x) {
+				int a = order[x];
+				if (colClass[a] != -1)
+					continue;
+				colClass[a] = a;
+				for (int y = x + 1; y < e; ++y) {
+					int b = order[y];
+					if (colClass[b] != -1)
+						continue;
+					bool same = true;
+					for (int u = 0; u < rows && same; ++u)
+						same = tab.get(u, a) == tab.get(u, b);
+					if (same)
+						colClass[b] = a;
+				}
+			}
+			i = e;
+		}
+		int k = 0;
+		std::vector<int> renumber(cols, -1);
+		for (int j = 0; j < cols; ++j) {
+			if (renumber[colClass[j]] == -1)
+				renumber[colClass[j]] = k++;
+			colClass[j] = renumber[colClass[j]];
+		}
+		return k;
+	}
+	// dense table with one column per alphabet equivalence class, classOf[symbId] is the column of each symbol,
+	// the automaton's own table is returned when none of its columns can be merged
+	const TransitionTable &classTable(TransitionTable &buffer, std::vector<int> &classOf) const {
+		int m = sig.size();
+		classOf.assign(m, 0);
+		std::vector<int> colClass;
+		if (!isSparse) {
+			int k = identicalColumns(transitions, colClass);
+			if (k == transitions.cols()) {
+				for (int j = 0; j < m; ++j)
+					classOf[j] = column(j);
+				return transitions;
+			}
+			std::vector<int> represent(k, -1);
+			for (int c = transitions.cols() - 1; c >= 0; --c)
+				represent[colClass[c]] = c;
+			buffer.reset(n, k);
+			for (int u = 0; u < n; ++u)
+				for (int t = 0; t < k; ++t)
+					buffer.set(u, t, transitions.get(u, represent[t]));
 			for (int j = 0; j < m; ++j)
-				invTr[transitions[i][j]][j].push_back(i);
-		std::vector<std::vector<unsigned char>> distinguishable(n, std::vector<unsigned char>(n, 0u));
-		std::vector<std::pair<int, int>> que(n * (n - 1) / 2);
+				classOf[j] = colClass[column(j)];
+			return buffer;
+		}
+		// elementary intervals between all range boundaries, identical ones are merged afterwards
+		std::vector<int> cut(1, 0);
+		for (const std::vector<SparseRange> &row : sparseRows)
+			for (const SparseRange &r : row) {
+				cut.push_back(r.lo);
+				if (r.hi + 1 < m)
+					cut.push_back(r.hi + 1);
+			}
+		std::sort(cut.begin(), cut.end());
+		cut.erase(std::unique(cut.begin(), cut.end()), cut.end());
+		int intervals = (int)cut.size();
+		cut.push_back(m);
+		TransitionTable inter;
+		inter.reset(n, intervals);
+		for (int u = 0; u < n; ++u)
+			for (const SparseRange &r : sparseRows[u])
+				for (int t = (int)(std::lower_bound(cut.begin(), cut.end(), r.lo) - cut.begin()); cut[t] <= r.hi; ++t)
+					inter.set(u, t, r.to);
+		int k = identicalColumns(inter, colClass);
+		for (int t = 0; t < intervals; ++t)
+			for (int j = cut[t]; j < cut[t + 1]; ++j)
+				classOf[j] = colClass[t];
+		if (k == intervals) {
+			buffer = std::move(inter);
+			return buffer;
+		}
+		std::vector<int> represent(k, -1);
+		for (int t = intervals - 1; t >= 0; --t)
+			represent[colClass[t]] = t;
+		buffer.reset(n, k);
+		for (int u = 0; u < n; ++u)
+			for (int t = 0; t < k; ++t)
+				buffer.set(u, t, inter.get(u, represent[t]));
+		return buffer;
+	}
+	// one step functors for the matching loops, taking a state index and a symbol id
+	template <typename T>
+	struct DenseStepper {
+		const T *tab;
+		const int *cls;
+		int cols;
+		DenseStepper(const T *t, const int *c, int k) : tab(t), cls(c), cols(k) {}
+		int operator () (int u, int symbId) const {
+			T next = tab[(size_t)u * cols + (cls ? cls[symbId] : symbId)];
+			return next == (T)~(T)0 ? -1 : (int)next;
+		}
+	};
+	struct SparseStepper {
+		const DeterministicFiniteAutomaton *dfa;
+		SparseStepper(const DeterministicFiniteAutomaton *d) : dfa(d) {}
+		int operator () (int u, int symbId) const {
+			return dfa->sparseGet(u, symbId);
+		}
+	};
+	// counts every step into a MatchProfile around another stepper
+	template <typename Stepper>
+	struct ProfilingStepper {
+		const Stepper &step;
+		MatchProfile &prof;
+		int operator () (int u, int symbId) const {
+			++prof.transitions[(size_t)u * prof.columns + prof.columnOf[symbId]];
+			int v = step(u, symbId);
+			if (v != -1)
+				++prof.visits[v];
+			return v;
+		}
+	};
+	template <typename Stepper>
+	int runProfiled(const Stepper &step, MatchProfile &prof, const char *first, const char *last) const {
+		return runTable(ProfilingStepper<Stepper>{step, prof}, startStateIndex, first, last);
+	}
+	const int *classData() const {
+		return symbolClass.empty() ? nullptr : symbolClass.data();
+	}
+	// walks the table from the given state index, returns -1 once an empty transition is met
+	// every symbol is still checked against the alphabet after that
+	template <typename Stepper, typename C>
+	int runTable(const Stepper &step, int index, const C *first, const C *last) const {
+		int m = sig.size();
+		for (; first != last; ++first) {
+			int symbId = sig.lookup((int)*first);
+			if (symbId < 0 || symbId >= m)
+				sig.c2i((int)*first);
+			if (index == -1)
+				continue;
+			index = step(index, symbId);
+		}
+		return index;
+	}
+	template <typename C>
+	int runSymbols(int index, const C *first, const C *last) const {
+		if (isSparse)
+			return runTable(SparseStepper(this), index, first, last);
+		if (transitions.width() == 1)
+			return runTable(DenseStepper<uint8_t>(transitions.data8(), classData(), transitions.cols()), index, first, last);
+		if (transitions.width() == 2)
+			return runTable(DenseStepper<uint16_t>(transitions.data16(), classData(), transitions.cols()), index, first, last);
+		return runTable(DenseStepper<uint32_t>(transitions.data32(), classData(), transitions.cols()), index, first, last);
+	}
+	// mapping[s] = state reached from s after reading [first, last), -1 if the run dies
+	// the live runs are kept distinct, each one carries a linked list of the states it started from
+	template <typename Stepper>
+	void chunkMapping(const Stepper &step, const char *first, const char *last, std::vector<int> &mapping) const {
+		int m = sig.size();
+		std::vector<int> cur(n), head(n), tail(n), link(n, -1);
+		std::vector<int> nextCur(n), nextHead(n), nextTail(n);
+		std::vector<int> slotOf(n, -1);
+		for (int i = 0; i < n; ++i)
+			cur[i] = head[i] = tail[i] = i;
+		int live = n;
+		for (; first != last; ++first) {
+			int c = (int)*first;
+			int symbId = sig.lookup(c);
+			if (symbId < 0 || symbId >= m)
+				sig.c2i(c);
+			int k = 0;
+			for (int i = 0; i < live; ++i) {
+				int v = step(cur[i], symbId);
+				if (v == -1)
+					continue;
+				int slot = slotOf[v];
+				if (slot == -1) {
+					slotOf[v] = slot = k++;
+					nextCur[slot] = v, nextHead[slot] = head[i], nextTail[slot] = tail[i];
+				}
+				else {
+					link[nextTail[slot]] = head[i];
+					nextTail[slot] = tail[i];
+				}
+			}
+			for (int i = 0; i < k; ++i)
+				slotOf[nextCur[i]] = -1;
+			live = k;
+			cur.swap(nextCur), head.swap(nextHead), tail.swap(nextTail);
+		}
+		mapping.assign(n, -1);
+		for (int i = 0; i < live; ++i) {
+			link[tail[i]] = -1;
+			for (int u = head[i]; u != -1; u = link[u])
+				mapping[u] = cur[i];
+		}
+	}
+	void chunkMapping(const char *first, const char *last, std::vector<int> &mapping) const {
+		if (isSparse)
+			chunkMapping(SparseStepper(this), first, last, mapping);
+		else if (transitions.width() == 1)
+			chunkMapping(DenseStepper<uint8_t>(transitions.data8(), classData(), transitions.cols()), first, last, mapping);
+		else if (transitions.width() == 2)
+			chunkMapping(DenseStepper<uint16_t>(transitions.data16(), classData(), transitions.cols()), first, last, mapping);
+		else
+			chunkMapping(DenseStepper<uint32_t>(transitions.data32(), classData(), transitions.cols()), first, last, mapping);
+	}
+	static const int batchLanes = 8;
+	template <typename Stepper>
+	void runBatch(const Stepper &step, const char *const *inputs, const size_t *lengths, size_t count, int *finalStates) const {
+		const size_t idle = (size_t)-1;
+		int m = sig.size();
+		const char *cur[batchLanes], *end[batchLanes];
+		int state[batchLanes];
+		size_t which[batchLanes];
+		size_t next = 0;
+		int active = 0;
+		for (int k = 0; k < batchLanes; ++k) {
+			cur[k] = end[k] = nullptr, state[k] = -1, which[k] = idle;
+			if (next < count) {
+				cur[k] = inputs[next], end[k] = cur[k] + lengths[next];
+				state[k] = startStateIndex, which[k] = next++, ++active;
+			}
+		}
+		while (active) {
+			for (int k = 0; k < batchLanes; ++k) {
+				if (cur[k] == end[k]) {
+					if (which[k] == idle)
+						continue;
+					finalStates[which[k]] = state[k];
+					if (next < count) {
+						cur[k] = inputs[next], end[k] = cur[k] + lengths[next];
+						state[k] = startStateIndex, which[k] = next++;
+					}
+					else
+						which[k] = idle, --active;
+					continue;
+				}
+				int c = (int)*cur[k]++;
+				int symbId = sig.lookup(c);
+				if (symbId < 0 || symbId >= m)
+					sig.c2i(c);
+				if (state[k] == -1)
+					continue;
+				state[k] = step(state[k], symbId);
+			}
+		}
+	}
+#if defined(__AVX2__) && defined(DFA_BATCH_GATHER)
+	// same lane scheduling as runBatch, the table loads of all lanes are issued as one 32-bit gather
+	// at byte offsets, narrow entries are masked out of the gathered words afterwards
+	void runBatchGather(const char *base, const char *const *inputs, const size_t *lengths, size_t count, int *finalStates) const {
+		const size_t idle = (size_t)-1;
+		int m = transitions.cols(), w = transitions.width();
+		const char *cur[batchLanes], *end[batchLanes];
+		alignas(32) int state[batchLanes];
+		alignas(32) int symbIds[batchLanes];
+		size_t which[batchLanes];
+		size_t next = 0;
+		int active = 0;
+		for (int k = 0; k < batchLanes; ++k) {
+			cur[k] = end[k] = nullptr, state[k] = -1, which[k] = idle;
+			if (next < count) {
+				cur[k] = inputs[next], end[k] = cur[k] + lengths[next];
+				state[k] = startStateIndex, which[k] = next++, ++active;
+			}
+		}
+		const __m256i vm = _mm256_set1_epi32(m);
+		const __m256i vw = _mm256_set1_epi32(w);
+		const __m256i entryMask = _mm256_set1_epi32(w == 4 ? -1 : (1 << (8 * w)) - 1);
+		const __m256i minusOne = _mm256_set1_epi32(-1);
+		while (active) {
+			for (int k = 0; k < batchLanes; ++k) {
+				symbIds[k] = -1;
+				if (cur[k] == end[k]) {
+					if (which[k] == idle)
+						continue;
+					finalStates[which[k]] = state[k];
+					if (next < count) {
+						cur[k] = inputs[next], end[k] = cur[k] + lengths[next];
+						state[k] = startStateIndex, which[k] = next++;
+					}
+					else
+						which[k] = idle, --active;
+					continue;
+				}
+				int c = (int)*cur[k]++;
+				int symbId = sig.lookup(c);
+				if (symbId < 0 || symbId >= m)
+					sig.c2i(c);
+				symbIds[k] = symbId;
+			}
+			__m256i vs = _mm256_load_si256((const __m256i *)state);
+			__m256i vj = _mm256_load_si256((const __m256i *)symbIds);
+			__m256i live = _mm256_andnot_si256(_mm256_or_si256(_mm256_cmpeq_epi32(vs, minusOne), _mm256_cmpeq_epi32(vj, minusOne)), minusOne);
+			__m256i offset = _mm256_mullo_epi32(_mm256_add_epi32(_mm256_mullo_epi32(vs, vm), vj), vw);
+			__m256i got = _mm256_mask_i32gather_epi32(vs, (const int *)base, offset, live, 1);
+			got = _mm256_blendv_epi8(got, _mm256_and_si256(got, entryMask), live);
+			got = _mm256_blendv_epi8(got, minusOne, _mm256_and_si256(_mm256_cmpeq_epi32(got, entryMask), live));
+			_mm256_store_si256((__m256i *)state, got);
+		}
+	}
+#endif
+	// automaton of the given size with the same alphabet, storage mode and column layout, and no transitions
+	DeterministicFiniteAutomaton emptyLike(int siz) const {
+		DeterministicFiniteAutomaton ret(sig);
+		ret.isSparse = isSparse;
+		ret.setSize(siz);
+		if (!isSparse && !symbolClass.empty()) {
+			ret.symbolClass = symbolClass;
+			ret.transitions.reset(siz, transitions.cols());
+		}
+		return ret;
+	}
+	// the name set to state u or merged into it, empty if it has the default one
+	std::string explicitName(int u) const {
+		if (!stateNames[u].empty() || !mergedNames)
+			return stateNames[u];
+		return mergedNames->name(u);
+	}
+	// record of the names of this automaton for one whose state newIndex[u] came from state u (-1 if dropped),
+	// a one to one record without names set since is folded in instead of being chained
+	std::shared_ptr<const MergedNames> mergeNames(const std::vector<int> &newIndex, int newSize, std::vector<std::string> names) const {
+		std::shared_ptr<MergedNames> ret = std::make_shared<MergedNames>();
+		bool named = false;
+		for (int u = 0; u < n && !named; ++u)
+			named = !names[u].empty();
+		const MergedNames *fold = nullptr;
+		if (!named && mergedNames && mergedNames->oneToOne && mergedNames->size() == n)
+			fold = mergedNames.get();
+		std::vector<unsigned char> hit(newSize, 0u);
+		ret->oneToOne = true;
+		for (int u = 0; u < n; ++u)
+			if (newIndex[u] != -1) {
+				ret->oneToOne = ret->oneToOne && !hit[newIndex[u]];
+				hit[newIndex[u]] = 1u;
+			}
+		if (ret->oneToOne) {
+			ret->sources.resize(newSize);
+			for (int u = 0; u < n; ++u)
+				if (newIndex[u] != -1)
+					ret->sources[newIndex[u]] = fold ? fold->sources[u] : u;
+		}
+		else {
+			ret->begin.assign(newSize + 1, 0);
+			for (int u = 0; u < n; ++u)
+				if (newIndex[u] != -1)
+					++ret->begin[newIndex[u] + 1];
+			for (int v = 0; v < newSize; ++v)
+				ret->begin[v + 1] += ret->begin[v];
+			ret->sources.resize(ret->begin[newSize]);
+			std::vector<int> pos(ret->begin.begin(), ret->begin.end() - 1);
+			for (int u = 0; u < n; ++u)
+				if (newIndex[u] != -1)
+					ret->sources[pos[newIndex[u]]++] = fold ? fold->sources[u] : u;
+		}
+		if (fold)
+			ret->names = fold->names, ret->before = fold->before;
+		else {
+			if (named)
+				ret->names = std::move(names);
+			ret->before = mergedNames;
+		}
+		return ret;
+	}
+	// the same automaton with state u renumbered to newIndex[u], newIndex is a permutation
+	DeterministicFiniteAutomaton permuted(const std::vector<int> &newIndex) const {
+		DeterministicFiniteAutomaton ret = emptyLike(n);
+		for (int u = 0; u < n; ++u) {
+			int nu = newIndex[u];
+			if (isSparse) {
+				ret.sparseRows[nu] = sparseRows[u];
+				for (SparseRange &r : ret.sparseRows[nu])
+					r.to = newIndex[r.to];
+			}
+			else
+				for (int c = 0; c < transitions.cols(); ++c) {
+					int v = transitions.get(u, c);
+					if (v != -1)
+						ret.transitions.set(nu, c, newIndex[v]);
+				}
+			ret.acceptStates[nu] = acceptStates[u];
+			if (!mergedNames)
+				ret.stateNames[nu] = stateNames[u];
+		}
+		if (!acceptLabels.empty()) {
+			ret.acceptLabels.resize(n);
+			for (int u = 0; u < n; ++u)
+				ret.acceptLabels[newIndex[u]] = acceptLabels[u];
+		}
+		if (mergedNames)
+			ret.mergedNames = mergeNames(newIndex, n, stateNames);
+		ret.countEmptyTransitions = countEmptyTransitions;
+		ret.isComplete = isComplete;
+		ret.startStateIndex = startStateIndex == -1 ? -1 : newIndex[startStateIndex];
+		return ret;
+	}
+	// targets of u in order of their symbols
+	void successors(int u, std::vector<int> &out) const {
+		out.clear();
+		if (isSparse)
+			for (const SparseRange &r : sparseRows[u])
+				out.push_back(r.to);
+		else
+			for (int c = 0; c < transitions.cols(); ++c) {
+				int v = transitions.get(u, c);
+				if (v != -1)
+					out.push_back(v);
+			}
+	}
+	// states reachable from the start state in breadth first or depth first preorder, symbols in increasing order
+	std::vector<int> traversal(bool depthFirst) const {
+		std::vector<int> ret, next, stack;
+		std::vector<unsigned char> seen(n, 0u);
+		if (startStateIndex == -1)
+			return ret;
+		if (!depthFirst) {
+			seen[startStateIndex] = 1u;
+			ret.push_back(startStateIndex);
+			for (size_t h = 0; h < ret.size(); ++h) {
+				successors(ret[h], next);
+				for (int v : next)
+					if (!seen[v])
+						seen[v] = 1u, ret.push_back(v);
+			}
+			return ret;
+		}
+		// a state is numbered when it is popped, so the targets are pushed in reverse
+		stack.push_back(startStateIndex);
+		while (!stack.empty()) {
+			int u = stack.back();
+			stack.pop_back();
+			if (seen[u])
+				continue;
+			seen[u] = 1u;
+			ret.push_back(u);
+			successors(u, next);
+			for (int i = (int)next.size() - 1; i >= 0; --i)
+				if (!seen[next[i]])
+					stack.push_back(next[i]);
+		}
+		return ret;
+	}
+	// renumbers the states in the given order, the states missing from it keep their relative order after them
+	DeterministicFiniteAutomaton reordered(const std::vector<int> &order, std::vector<int> *mapping) const {
+		std::vector<int> newIndex(n, -1);
+		int k = 0;
+		for (int u : order)
+			newIndex[u] = k++;
+		for (int u = 0; u < n; ++u)
+			if (newIndex[u] == -1)
+				newIndex[u] = k++;
+		if (mapping)
+			*mapping = newIndex;
+		return permuted(newIndex);
+	}
+	// alphabet equivalence classes of two automata over the same alphabet joined together,
+	// symbols in one joint class c behave alike in both, which read columns colA[c] and colB[c] of their class tables
+	struct JointClasses {
+		TransitionTable bufferA, bufferB;
+		const TransitionTable *tabA, *tabB;
+		std::vector<int> joint, colA, colB, firstSymbol;
+		int size() const {
+			return (int)colA.size();
+		}
+		int stepA(int p, int c) const {
+			return p == -1 ? -1 : tabA->get(p, colA[c]);
+		}
+		int stepB(int q, int c) const {
+			return q == -1 ? -1 : tabB->get(q, colB[c]);
+		}
+	};
+	void jointClasses(const DeterministicFiniteAutomaton &other, JointClasses &jc, const char *func) const {
+		if (startStateIndex == -1 || other.startStateIndex == -1)
+			RE("[Error] DFA::%s : Start state unset.", func);
+		int m = sig.size();
+		if (m != other.sig.size())
+			RE("[Error] DFA::%s : Alphabet sizes (%d and %d) differ.", func, m, other.sig.size());
+		for (int j = 0; j < m; ++j)
+			if (sig.i2c(j) != other.sig.i2c(j))
+				RE("[Error] DFA::%s : Alphabets differ at symbol id %d.", func, j);
+		std::vector<int> classA, classB;
+		jc.tabA = &classTable(jc.bufferA, classA);
+		jc.tabB = &other.classTable(jc.bufferB, classB);
+		jc.joint.resize(m);
+		std::unordered_map<uint64_t, int> jointId;
+		uint64_t lastKey = ~0ull;
+		for (int j = 0; j < m; ++j) {
+			uint64_t key = (uint64_t)classA[j] << 32 | (uint32_t)classB[j];
+			if (key == lastKey) {
+				jc.joint[j] = jc.joint[j - 1];
+				continue;
+			}
+			lastKey = key;
+			std::unordered_map<uint64_t, int>::iterator it = jointId.find(key);
+			if (it == jointId.end()) {
+				it = jointId.emplace(key, jc.size()).first;
+				jc.colA.push_back(classA[j]);
+				jc.colB.push_back(classB[j]);
+				jc.firstSymbol.push_back(j);
+			}
+			jc.joint[j] = it->second;
+		}
+	}
+	// ids of the state pairs (p, q) in order of insertion, -1 on a side stands for its dead state,
+	// a flat array is used while (n1 + 1) * (n2 + 1) is small and a hash map otherwise
+	struct PairIndex {
+		uint64_t width;
+		bool flat;
+		std::vector<int> flatIndex;
+		std::unordered_map<uint64_t, int> hashIndex;
+		std::vector<int> first, second;
+		PairIndex(int n1, int n2) : width((uint64_t)n2 + 1), flat(((uint64_t)n1 + 1) * width <= (1ull << 22)) {
+			if (flat)
+				flatIndex.assign(((uint64_t)n1 + 1) * width, -1);
+		}
+		int size() const {
+			return (int)first.size();
+		}
+		// id of the pair, inserted is set when it was not seen before
+		int insert(int p, int q, bool &inserted) {
+			uint64_t key = (uint64_t)(p + 1) * width + (uint64_t)(q + 1);
+			int id = size();
+			inserted = false;
+			if (flat) {
+				if (flatIndex[key] != -1)
+					return flatIndex[key];
+				flatIndex[key] = id;
+			}
+			else {
+				std::pair<std::unordered_map<uint64_t, int>::iterator, bool> res = hashIndex.emplace(key, id);
+				if (!res.second)
+					return res.first->second;
+			}
+			inserted = true;
+			first.push_back(p);
+			second.push_back(q);
+			return id;
+		}
+	};
+	// states from which an accept state can be reached, by a backward search over the table
+	std::vector<unsigned char> liveStates(const TransitionTable &tab) const {
+		int k = tab.cols();
+		std::vector<int> begin(n + 1, 0), src;
+		for (int u = 0; u < n; ++u)
+			for (int c = 0; c < k; ++c) {
+				int v = tab.get(u, c);
+				if (v != -1)
+					++begin[v + 1];
+			}
+		for (int v = 0; v < n; ++v)
+			begin[v + 1] += begin[v];
+		src.resize(begin[n]);
+		std::vector<int> pos(begin.begin(), begin.end() - 1);
+		for (int u = 0; u < n; ++u)
+			for (int c = 0; c < k; ++c) {
+				int v = tab.get(u, c);
+				if (v != -1)
+					src[pos[v]++] = u;
+			}
+		std::vector<unsigned char> ret(acceptStates);
+		std::vector<int> que;
+		for (int u = 0; u < n; ++u)
+			if (ret[u])
+				que.push_back(u);
+		for (size_t h = 0; h < que.size(); ++h)
+			for (int i = begin[que[h]]; i < begin[que[h] + 1]; ++i)
+				if (!ret[src[i]]) {
+					ret[src[i]] = 1u;
+					que.push_back(src[i]);
+				}
+		return ret;
+	}
+	// breadth first search over the reachable pairs for one whose acceptance bits select a set bit of accTable
+	// (see product), states which cannot reach an accept state count as dead,
+	// a shortest word leading to such a pair is stored in word when it is found
+	bool pairWitness(const DeterministicFiniteAutomaton &other, const JointClasses &jc, int accTable, std::vector<int> *word) const {
+		int k = jc.size();
+		std::vector<unsigned char> liveA = liveStates(*jc.tabA), liveB = other.liveStates(*jc.tabB);
+		PairIndex index(n, other.n);
+		std::vector<int> from, via;
+		auto visit = [&](int p, int q, int parent, int c) {
+			if (p != -1 && !liveA[p])
+				p = -1;
+			if (q != -1 && !liveB[q])
+				q = -1;
+			if (p == -1 ? !(accTable & (q == -1 ? 0x1 : 0x3)) : q == -1 && !(accTable & 0x5))
+				return ;
+			bool inserted;
+			index.insert(p, q, inserted);
+			if (inserted) {
+				from.push_back(parent);
+				via.push_back(c);
+			}
+		};
+		visit(startStateIndex, other.startStateIndex, -1, -1);
+		for (int u = 0; u < index.size(); ++u) {
+			int p = index.first[u], q = index.second[u];
+			int a = p != -1 && acceptStates[p], b = q != -1 && other.acceptStates[q];
+			if (accTable >> (a * 2 + b) & 1) {
+				if (word) {
+					word->clear();
+					for (int v = u; from[v] != -1; v = from[v])
+						word->push_back(sig.i2c(jc.firstSymbol[via[v]]));
+					std::reverse(word->begin(), word->end());
+				}
+				return true;
+			}
+			for (int c = 0; c < k; ++c)
+				visit(jc.stepA(p, c), jc.stepB(q, c), u, c);
+		}
+		return false;
+	}
+	// product automaton of this and other, only pairs reachable from the pair of start states are explored,
+	// bit (2a + b) of accTable tells whether a pair whose states accept a and b accepts,
+	// a missing transition leads to a dead side (index -1) that never accepts again
+	DeterministicFiniteAutomaton product(const DeterministicFiniteAutomaton &other, int accTable, bool minimized, const char *func) const {
+		int m = sig.size();
+		JointClasses jc;
+		jointClasses(other, jc, func);
+		int k = jc.size();
+		PairIndex index(n, other.n);
+		std::vector<int> out;
+		auto visit = [&](int p, int q) -> int {
+			if (p == -1 ? !(accTable & (q == -1 ? 0x1 : 0x3)) : q == -1 && !(accTable & 0x5))
+				return -1; // the pair can never accept again
+			bool inserted;
+			return index.insert(p, q, inserted);
+		};
+		visit(startStateIndex, other.startStateIndex);
+		for (int u = 0; u < index.size(); ++u) {
+			int p = index.first[u], q = index.second[u];
+			for (int c = 0; c < k; ++c)
+				out.push_back(visit(jc.stepA(p, c), jc.stepB(q, c)));
+		}
+		std::vector<int> &first = index.first, &second = index.second, &joint = jc.joint;
+		int siz = (int)first.size();
+		DeterministicFiniteAutomaton ret(sig);
+		ret.isSparse = true; // no dense table is allocated before its final width is known
+		ret.setSize(siz);
+		if (isSparse || other.isSparse) {
+			// maximal runs of symbols within one joint class
+			std::vector<SparseRange> runs;
+			for (int j = 0; j < m; ++j) {
+				if (!runs.empty() && runs.back().to == joint[j])
+					++runs.back().hi;
+				else
+					runs.push_back({j, j, joint[j]});
+			}
+			for (int u = 0; u < siz; ++u) {
+				std::vector<SparseRange> &row = ret.sparseRows[u];
+				for (const SparseRange &r : runs) {
+					int v = out[(size_t)u * k + r.to];
+					if (v == -1)
+						continue;
+					if (!row.empty() && row.back().hi + 1 == r.lo && row.back().to == v)
+						row.back().hi = r.hi;
+					else
+						row.push_back({r.lo, r.hi, v});
+				}
+				row.shrink_to_fit();
+			}
+		}
+		else {
+			ret.isSparse = false;
+			std::vector<std::vector<SparseRange>>().swap(ret.sparseRows);
+			ret.transitions.reset(siz, k);
+			for (int u = 0; u < siz; ++u)
+				for (int c = 0; c < k; ++c)
+					ret.transitions.set(u, c, out[(size_t)u * k + c]);
+			bool identity = k == m;
+			for (int j = 0; identity && j < m; ++j)
+				identity = joint[j] == j;
+			if (!identity)
+				ret.symbolClass.swap(joint);
+		}
+		ret.countEmptyTransitions = ret.countEmptyEntries();
+		ret.isComplete = ret.countEmptyTransitions == 0;
+		for (int u = 0; u < siz; ++u) {
+			int a = first[u] != -1 && acceptStates[first[u]], b = second[u] != -1 && other.acceptStates[second[u]];
+			ret.acceptStates[u] = (unsigned char)(accTable >> (a * 2 + b) & 1);
+		}
+		if (!acceptLabels.empty() || !other.acceptLabels.empty()) {
+			ret.acceptLabels.assign(siz, 0);
+			for (int u = 0; u < siz; ++u) {
+				int a = first[u] == -1 ? -1 : labelOf(first[u]), b = second[u] == -1 ? -1 : other.labelOf(second[u]);
+				if (a != -1 || b != -1)
+					ret.acceptLabels[u] = a == -1 ? b : b == -1 ? a : std::min(a, b);
+			}
+		}
+		ret.startStateIndex = 0;
+		if (minimized)
+			return std::move(ret).minimize(true);
+		return ret;
+	}
+	// instrumentation policies of the refinement algorithms, the calls on NoStats compile to nothing
+	enum Phase {
+		PhaseStart, PhaseInverse, PhaseRefine, PhaseCollect
+	};
+	struct NoStats {
+		void phase(Phase) {}
+		void split(unsigned long long) {}
+		void push(size_t) {}
+		void mark(unsigned long long) {}
+		void scratch(size_t) {}
+		void columns(int, int) {}
+		void classes(const std::vector<int> &) {}
+	};
+	struct StatsRecorder {
+		MinimizationStats &stats;
+		std::chrono::steady_clock::time_point last;
+		StatsRecorder(MinimizationStats &s) : stats(s), last(std::chrono::steady_clock::now()) {
+			stats = MinimizationStats();
+		}
+		// the time since the previous call goes to the phase which has just ended
+		void phase(Phase p) {
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			double sec = std::chrono::duration<double>(now - last).count();
+			if (p == PhaseInverse)
+				stats.inverseSeconds += sec;
+			else if (p == PhaseRefine)
+				stats.refineSeconds += sec;
+			else if (p == PhaseCollect)
+				stats.collectSeconds += sec;
+			last = now;
+		}
+		void split(unsigned long long cnt) {
+			stats.splits += cnt;
+		}
+		// one more splitter with depth of them pending
+		void push(size_t depth) {
+			++stats.splitterPushes;
+			stats.peakSplitters = std::max(stats.peakSplitters, depth);
+		}
+		void mark(unsigned long long cnt) {
+			stats.marks += cnt;
+		}
+		void scratch(size_t bytes) {
+			stats.scratchBytes = std::max(stats.scratchBytes, bytes);
+		}
+		void columns(int states, int cols) {
+			stats.states = states, stats.columns = cols;
+		}
+		void classes(const std::vector<int> &eqv) {
+			stats.classes = eqv.empty() ? 0 : *std::max_element(eqv.begin(), eqv.end()) + 1;
+		}
+	};
+	// table filling algorithm with a queue to efficiently select pairs which distinguishable
+	// O(n^2 m), with n = #nodes, m = |alpabet|
+	// assuming DFA is complete
+	// discarded, use equivalenceClassesHopcroft for a better performance
+	// only for studying purpose
+	std::vector<int> equivalenceClassesTableFilling(const TransitionTable &tab) const {
+		int m = tab.cols();
+		std::vector<std::vector<std::vector<int>>> invTr(n, std::vector<std::vector<int>>(m));
+		for (int i = 0; i < n; ++i)
+			for (int j = 0; j < m; ++j)
+				invTr[tab.get(i, j)][j].push_back(i);
+		std::vector<std::vector<unsigned char>> distinguishable(n, std::vector<unsigned char>(n, 0u));
+		std::vector<std::pair<int, int>> que(n * (n - 1) / 2);
 		int head = 0, tail = 0;
 		for (int i = 0; i < n; ++i)
 			for (int j = 0; j < i; ++j)
-				if (acceptStates[j] != acceptStates[i])
+				if (labelOf(j) != labelOf(i))
 					distinguishable[i][j] = 1u,
 					que[tail++] = {i, j};
 		while (head != tail) {
@@ -449,49 +2244,71 @@ private:
 	// Hopcroft algorithm (1971) with a refined implementation
 	// O(m n log n), with n = #nodes, m = |alpabet|
 	// assuming DFA is complete
-	std::vector<int> equivalenceClassesHopcroft() const {
-		bool allAccept = true, allReject = true;
-		for (int i = 0; i < n; ++i)
-			if (acceptStates[i])
-				allReject = false;
-			else
-				allAccept = false;
-		if (allAccept || allReject)
+	// every structure is a flat array allocated once: inverse transitions in CSR form,
+	// a bitmap for the splitters in the stack, and the elements of a class being split
+	// are moved to the front of its range instead of being collected per class
+	std::vector<int> equivalenceClassesHopcroft(const TransitionTable &tab) const {
+		NoStats stats;
+		return equivalenceClassesHopcroft(tab, stats);
+	}
+	template <typename Stats>
+	std::vector<int> equivalenceClassesHopcroft(const TransitionTable &tab, Stats &stats, int threads = 1) const {
+		stats.phase(PhaseStart);
+		std::vector<int> groupOf;
+		int groups = labelGroups(groupOf);
+		if (groups == 1)
 			return std::vector<int>(n, 0);
-		int m = sig.size();
-		std::vector<std::vector<std::vector<int>>> invTr(n, std::vector<std::vector<int>>(m));
-		for (int i = 0; i < n; ++i)
-			for (int j = 0; j < m; ++j)
-				invTr[transitions[i][j]][j].push_back(i);
+		int m = tab.cols();
+		size_t total = (size_t)n * m;
+		if (total >= (size_t)0xFFFFFFFFu)
+			RE("[Error] DFA::equivalenceClassesHopcroft : Too many transitions (%zu).", total);
+		// sources of the j-transitions into v are invSrc[invBegin[j * n + v] .. invBegin[j * n + v + 1])
+		std::vector<uint32_t> invBegin;
+		std::vector<int> invSrc;
+		inverseTransitions(tab, invBegin, invSrc, threads);
+		stats.phase(PhaseInverse);
 		std::vector<int> classBegin(n);
 		std::vector<int> classSize(n);
 		std::vector<int> classElems(n);
-		std::vector<int> classSplitCnt(n, 0);
-		std::vector<std::vector<int>> classSplitElems(n);
+		std::vector<int> classMarked(n, 0);
 		std::vector<int> elemBelong(n);
 		std::vector<int> elemPosition(n);
-		int num = 0;
-		std::vector<std::pair<int, int>> splitterStack(n * m);
-		std::vector<std::vector<unsigned char>> inStack(n, std::vector<unsigned char>(m, 0u));
-		int stackTop = 0;
-		auto Split = [&](int id, const std::vector<int> &elems) -> int {
+		std::vector<int> touched;
+		std::vector<int> candidates(n);
+		int num = 0, candCnt = 0;
+		std::vector<std::pair<int, int>> splitterStack;
+		splitterStack.reserve(2 * m);
+		std::vector<uint64_t> inStack(total / 64 + 1, 0ull);
+		auto stacked = [&](int id, int j) -> bool {
+			size_t k = (size_t)id * m + j;
+			return (inStack[k >> 6] >> (k & 63)) & 1u;
+		};
+		auto flip = [&](int id, int j) {
+			size_t k = (size_t)id * m + j;
+			inStack[k >> 6] ^= 1ull << (k & 63);
+		};
+		auto Mark = [&](int a) {
+			int id = elemBelong[a];
+			int pa = elemPosition[a];
+			int pb = classBegin[id] + classMarked[id];
+			int b = classElems[pb];
+			elemPosition[a] = pb;
+			elemPosition[b] = pa;
+			classElems[pb] = a;
+			classElems[pa] = b;
+			if (!classMarked[id]++)
+				candidates[candCnt++] = id;
+		};
+		// the marked front part of class id becomes the new class
+		auto Split = [&](int id) -> int {
 			int jd = num++;
-			int siz = (int)elems.size();
-			int pb = classBegin[id];
-			for (int j = 0; j < siz; ++j, ++pb) {
-				int a = elems[j];
-				int pa = elemPosition[a];
-				int b = classElems[pb];
-				elemPosition[a] = pb;
-				elemPosition[b] = pa;
-				classElems[pb] = a;
-				classElems[pa] = b;
-				elemBelong[a] = jd;
-			}
+			int siz = classMarked[id];
 			classBegin[jd] = classBegin[id];
-			classBegin[id] = pb;
 			classSize[jd] = siz;
+			classBegin[id] += siz;
 			classSize[id] -= siz;
+			for (int k = 0; k < siz; ++k)
+				elemBelong[classElems[classBegin[jd] + k]] = jd;
 			return jd;
 		};
 		classBegin[num] = 0;
@@ -502,52 +2319,71 @@ private:
 			elemPosition[i] = classBegin[num] + i;
 		}
 		++num;
-		Split(0, [&]() -> std::vector<int> {
-			std::vector<int> ret;
+		// every label group but the largest is split off class 0, and all of them are splitters
+		{
+			std::vector<int> groupBegin(groups + 1, 0), byGroup(n);
 			for (int i = 0; i < n; ++i)
-				if (acceptStates[i])
-					ret.push_back(i);
-			return ret;
-		}());
-		for (int j = 0; j < m; ++j) {
-			int id = classSize[0] < classSize[1] ? 0 : 1;
-			splitterStack[stackTop++] = {id, j};
-			inStack[id][j] = 1u;
+				++groupBegin[groupOf[i] + 1];
+			int largest = 0;
+			for (int g = 0; g < groups; ++g)
+				if (groupBegin[g + 1] > groupBegin[largest + 1])
+					largest = g;
+			for (int g = 0; g < groups; ++g)
+				groupBegin[g + 1] += groupBegin[g];
+			std::vector<int> pos(groupBegin.begin(), groupBegin.end() - 1);
+			for (int i = 0; i < n; ++i)
+				byGroup[pos[groupOf[i]]++] = i;
+			for (int g = 0; g < groups; ++g) {
+				if (g == largest)
+					continue;
+				for (int i = groupBegin[g]; i < groupBegin[g + 1]; ++i)
+					Mark(byGroup[i]);
+				Split(0);
+				classMarked[0] = 0, candCnt = 0;
+			}
+			stats.split((unsigned long long)groups - 1);
+			for (int id = 1; id < num; ++id)
+				for (int j = 0; j < m; ++j) {
+					splitterStack.push_back({id, j});
+					flip(id, j);
+					stats.push(splitterStack.size());
+				}
+			touched.swap(groupOf); // scratch of n elements from here on
 		}
-		while (stackTop) {
-			std::pair<int, int> p = splitterStack[--stackTop];
+		while (!splitterStack.empty()) {
+			std::pair<int, int> p = splitterStack.back();
+			splitterStack.pop_back();
 			int Aid = p.first, Aj = p.second;
-			inStack[Aid][Aj] = 0u;
-			std::vector<int> candidates;
+			flip(Aid, Aj);
+			int touchCnt = 0;
+			const uint32_t *base = invBegin.data() + (size_t)Aj * n;
 			for (int i = 0; i < classSize[Aid]; ++i) {
 				int elem = classElems[classBegin[Aid] + i];
-				for (int x : invTr[elem][Aj]) {
-					int bel = elemBelong[x];
-					if (!classSplitCnt[bel])
-						candidates.push_back(bel);
-					++classSplitCnt[bel];
-					classSplitElems[bel].push_back(x);
-				}
+				for (uint32_t k = base[elem]; k < base[elem + 1]; ++k)
+					touched[touchCnt++] = invSrc[k];
 			}
-			for (int id : candidates) {
-				if (classSplitCnt[id] != classSize[id]) {
-					int jd = Split(id, classSplitElems[id]);
+			for (int i = 0; i < touchCnt; ++i)
+				Mark(touched[i]);
+			stats.mark(touchCnt);
+			for (int c = 0; c < candCnt; ++c) {
+				int id = candidates[c];
+				if (classMarked[id] != classSize[id]) {
+					int jd = Split(id);
+					stats.split(1ull);
 					for (int j = 0; j < m; ++j) {
 						int Xid = jd;
-						if (!inStack[id][j])
+						if (!stacked(id, j))
 							Xid = classSize[id] < classSize[jd] ? id : jd;
-						splitterStack[stackTop++] = {Xid, j};
-						inStack[Xid][j] = 1u;
+						splitterStack.push_back({Xid, j});
+						flip(Xid, j);
+						stats.push(splitterStack.size());
 					}
 				}
-				classSplitCnt[id] = 0;
-				classSplitElems[id].clear();
+				classMarked[id] = 0;
 			}
+			candCnt = 0;
 		}
-		inStack.clear();
-		elemPosition.clear();
-		classSplitElems.clear();
-		classSplitCnt.clear();
+		stats.phase(PhaseRefine);
 		int classCnt = 0;
 		std::vector<int> ret(n, -1);
 		for (int i = 0; i < n; ++i) {
@@ -558,100 +2394,999 @@ private:
 				ret[classElems[classBegin[bel] + k]] = classCnt;
 			++classCnt;
 		}
+		stats.scratch(invBegin.capacity() * sizeof(uint32_t) + invSrc.capacity() * sizeof(int) + (size_t)n * 8 * sizeof(int)
+			+ inStack.capacity() * sizeof(uint64_t) + splitterStack.capacity() * sizeof(std::pair<int, int>) + ret.capacity() * sizeof(int));
+		stats.phase(PhaseCollect);
+		return ret;
+	}
+	// counting sort of the transitions of a complete table by (symbol, target), sources in increasing order,
+	// with several threads every one takes a range of targets of some columns and reads those columns whole,
+	// so the writes are split without any shared counters
+	void inverseTransitions(const TransitionTable &tab, std::vector<uint32_t> &invBegin, std::vector<int> &invSrc, int threads) const {
+		int m = tab.cols();
+		size_t total = (size_t)n * m;
+		invBegin.assign(total + 1, 0u);
+		invSrc.resize(total);
+		if (threads <= 1 || total < ((size_t)1 << 16)) {
+			for (int i = 0; i < n; ++i)
+				for (int j = 0; j < m; ++j)
+					++invBegin[(size_t)j * n + tab.get(i, j)];
+			for (size_t k = 1; k <= total; ++k)
+				invBegin[k] += invBegin[k - 1];
+			for (int i = n - 1; i >= 0; --i)
+				for (int j = 0; j < m; ++j)
+					invSrc[--invBegin[(size_t)j * n + tab.get(i, j)]] = i;
+			return ;
+		}
+		int ranges = (threads + m - 1) / m, tasks = m * ranges;
+		auto work = [&](int t, bool fill) {
+			for (int task = t; task < tasks; task += threads) {
+				int j = task / ranges, r = task % ranges;
+				int lo = (int)((long long)n * r / ranges), hi = (int)((long long)n * (r + 1) / ranges);
+				uint32_t *base = invBegin.data() + (size_t)j * n;
+				if (!fill) {
+					for (int i = 0; i < n; ++i) {
+						int v = tab.get(i, j);
+						if (v >= lo && v < hi)
+							++base[v];
+					}
+					continue;
+				}
+				for (int i = n - 1; i >= 0; --i) {
+					int v = tab.get(i, j);
+					if (v >= lo && v < hi)
+						invSrc[--base[v]] = i;
+				}
+			}
+		};
+		runThreads(threads, [&](int t) { work(t, false); });
+		for (size_t k = 1; k <= total; ++k)
+			invBegin[k] += invBegin[k - 1];
+		runThreads(threads, [&](int t) { work(t, true); });
+	}
+	// f(t) on threads threads at once, the calling thread runs f(0)
+	template <typename F>
+	static void runThreads(int threads, F f) {
+		if (threads <= 1)
+			return f(0);
+		std::vector<std::thread> workers;
+		for (int t = 1; t < threads; ++t)
+			workers.emplace_back([&f, t]() { f(t); });
+		f(0);
+		for (std::thread &worker : workers)
+			worker.join();
+	}
+	// Moore's refinement by rounds: every round hashes the signature (class, classes of the targets) of every state
+	// in parallel, then equal signatures are looked up within the shard their hash falls in, one shard per thread,
+	// and the smallest state of a signature names its class, so classes come out in order of appearance
+	// a missing transition goes to an extra dead state, and with a partial table the states in its class get -1
+	// as with Valmari and Lehtinen's algorithm; returns false without a result after maxRounds rounds
+	bool equivalenceClassesMoore(const TransitionTable &tab, int threads, int maxRounds, std::vector<int> &ret) const {
+		int k = tab.cols(), sink = n;
+		bool partial = !isComplete;
+		int total = n + (int)partial;
+		std::vector<int> groupOf;
+		int count = labelGroups(groupOf);
+		std::vector<int> cls(groupOf), next(total), rep(total);
+		std::vector<int>().swap(groupOf);
+		if (partial) {
+			int reject = -1;
+			for (int u = 0; u < n && reject == -1; ++u)
+				if (!acceptStates[u])
+					reject = cls[u];
+			cls.push_back(reject == -1 ? count++ : reject);
+		}
+		std::vector<uint64_t> hash(total);
+		auto target = [&](int u, int c) -> int {
+			int v = u == sink ? -1 : tab.get(u, c);
+			return v == -1 ? sink : v;
+		};
+		auto same = [&](int u, int r) -> bool {
+			if (cls[u] != cls[r])
+				return false;
+			for (int c = 0; c < k; ++c)
+				if (cls[target(u, c)] != cls[target(r, c)])
+					return false;
+			return true;
+		};
+		for (int round = 0; ; ++round) {
+			if (round == maxRounds)
+				return false;
+			runThreads(threads, [&](int t) {
+				int lo = (int)((long long)total * t / threads), hi = (int)((long long)total * (t + 1) / threads);
+				for (int u = lo; u < hi; ++u) {
+					uint64_t h = (uint64_t)cls[u] * 0x9E3779B97F4A7C15ull;
+					for (int c = 0; c < k; ++c) {
+						h = (h ^ (uint64_t)cls[target(u, c)]) * 0x100000001B3ull;
+						h ^= h >> 29;
+					}
+					hash[u] = h;
+				}
+			});
+			runThreads(threads, [&](int t) {
+				std::vector<int> mine;
+				for (int u = 0; u < total; ++u)
+					if ((int)(hash[u] >> 40) % threads == t)
+						mine.push_back(u);
+				size_t cap = 2;
+				while (cap < mine.size() * 2)
+					cap <<= 1;
+				std::vector<int> slots(cap, -1);
+				for (int u : mine) {
+					size_t i = (size_t)hash[u] & (cap - 1);
+					while (slots[i] != -1 && !(hash[slots[i]] == hash[u] && same(u, slots[i])))
+						i = (i + 1) & (cap - 1);
+					if (slots[i] == -1)
+						slots[i] = u;
+					rep[u] = slots[i];
+				}
+			});
+			int cnt = 0;
+			for (int u = 0; u < total; ++u)
+				next[u] = rep[u] == u ? cnt++ : next[rep[u]];
+			cls.swap(next);
+			if (cnt == count)
+				break;
+			count = cnt;
+		}
+		if (!partial) {
+			ret.assign(cls.begin(), cls.begin() + n);
+			return true;
+		}
+		std::vector<int> id(count, -1);
+		int cnt = 0;
+		ret.assign(n, -1);
+		for (int u = 0; u < n; ++u)
+			if (cls[u] != cls[sink]) {
+				if (id[cls[u]] == -1)
+					id[cls[u]] = cnt++;
+				ret[u] = id[cls[u]];
+			}
+		return true;
+	}
+	// classes in the form of Hopcroft's or Valmari and Lehtinen's algorithm, with Moore's rounds on several threads
+	// as long as they cost less than the serial algorithm would: measured on one thread, a round takes about
+	// (10 + k) units per state and Hopcroft's algorithm about 3 k log2(n), for k columns
+	// random automata need a few rounds, chains and de Bruijn cycles need about n or log2(n) and fall back
+	std::vector<int> parallelClasses(const TransitionTable &tab, int threads) const {
+		int k = tab.cols(), logN = 1;
+		while (logN < 30 && (1 << logN) < n)
+			++logN;
+		int maxRounds = std::max(2, (int)((long long)threads * 3 * k * logN / (10 + k)));
+		std::vector<int> ret;
+		if (threads > 1 && (size_t)n * k >= ((size_t)1 << 16) && equivalenceClassesMoore(tab, threads, maxRounds, ret))
+			return ret;
+		NoStats stats;
+		if (isComplete)
+			return equivalenceClassesHopcroft(tab, stats, threads);
+		return equivalenceClassesValmari(tab, stats);
+	}
+	// partition of a set of elements into sets with the marking and splitting of Valmari and Lehtinen
+	// elements of set s are E[F[s] .. P[s]), L[e] is the position of e in E, S[e] is its set
+	// M (marked count per set) and W (stack of touched sets) are scratch shared by several partitions
+	struct RefinablePartition {
+		int z;
+		std::vector<int> E, L, S, F, P;
+		void init(int cnt) {
+			z = cnt > 0 ? 1 : 0;
+			E.resize(cnt), L.resize(cnt), S.assign(cnt, 0), F.assign(cnt, 0), P.assign(cnt, 0);
+			for (int i = 0; i < cnt; ++i)
+				E[i] = L[i] = i;
+			if (z)
+				P[0] = cnt;
+		}
+		void mark(int e, std::vector<int> &M, std::vector<int> &W, int &w) {
+			int s = S[e], i = L[e], j = F[s] + M[s];
+			E[i] = E[j], L[E[i]] = i;
+			E[j] = e, L[e] = j;
+			if (!M[s]++)
+				W[w++] = s;
+		}
+		// the smaller of the marked and unmarked parts of every touched set becomes a new set,
+		// returns the number of new sets
+		int split(std::vector<int> &M, std::vector<int> &W, int &w) {
+			int before = z;
+			while (w) {
+				int s = W[--w], j = F[s] + M[s];
+				if (j == P[s]) {
+					M[s] = 0;
+					continue;
+				}
+				if (M[s] <= P[s] - j)
+					F[z] = F[s], P[z] = F[s] = j;
+				else
+					P[z] = P[s], F[z] = P[s] = j;
+				for (int i = F[z]; i < P[z]; ++i)
+					S[E[i]] = z;
+				M[s] = M[z++] = 0;
+			}
+			return z - before;
+		}
+	};
+	// Revuz's algorithm (1992) for automata whose states that can reach an accept state form no cycle
+	// every such state is classed once after all of its targets, by its label and the classes of its targets,
+	// taking the states from those without live targets upwards as Revuz's heights do, and hashing instead of sorting,
+	// O(n * m) for the n * m table, the classes are in the form of Valmari and Lehtinen's algorithm
+	std::vector<int> equivalenceClassesRevuz(const TransitionTable &tab, const char *func) const {
+		int k = tab.cols();
+		// the table is read twice into the lists of (column, target) of every state, the rest works on those
+		std::vector<int> begin(n + 1, 0);
+		for (int u = 0; u < n; ++u) {
+			begin[u + 1] = begin[u];
+			for (int c = 0; c < k; ++c)
+				begin[u + 1] += tab.get(u, c) != -1;
+		}
+		std::vector<std::pair<int, int>> edges(begin[n]);
+		for (int u = 0, e = 0; u < n; ++u)
+			for (int c = 0; c < k; ++c) {
+				int v = tab.get(u, c);
+				if (v != -1)
+					edges[e++] = std::make_pair(c, v);
+			}
+		std::vector<int> invBegin(n + 1, 0), invSrc(edges.size());
+		for (const std::pair<int, int> &e : edges)
+			++invBegin[e.second + 1];
+		for (int v = 0; v < n; ++v)
+			invBegin[v + 1] += invBegin[v];
+		{
+			std::vector<int> pos(invBegin.begin(), invBegin.end() - 1);
+			for (int u = 0; u < n; ++u)
+				for (int e = begin[u]; e < begin[u + 1]; ++e)
+					invSrc[pos[edges[e].second]++] = u;
+		}
+		// live states can reach an accept state, the others are dropped with the transitions into them
+		std::vector<unsigned char> live(acceptStates);
+		std::vector<int> order;
+		for (int u = 0; u < n; ++u)
+			if (live[u])
+				order.push_back(u);
+		for (size_t h = 0; h < order.size(); ++h)
+			for (int i = invBegin[order[h]]; i < invBegin[order[h] + 1]; ++i)
+				if (!live[invSrc[i]]) {
+					live[invSrc[i]] = 1u;
+					order.push_back(invSrc[i]);
+				}
+		int liveCount = (int)order.size();
+		std::vector<int> outDeg(n, 0);
+		for (int u = 0; u < n; ++u)
+			for (int e = begin[u]; live[u] && e < begin[u + 1]; ++e)
+				outDeg[u] += live[edges[e].second];
+		// from the states without live targets upwards
+		order.clear();
+		for (int u = 0; u < n; ++u)
+			if (live[u] && outDeg[u] == 0)
+				order.push_back(u);
+		for (size_t h = 0; h < order.size(); ++h)
+			for (int i = invBegin[order[h]]; i < invBegin[order[h] + 1]; ++i)
+				if (live[invSrc[i]] && --outDeg[invSrc[i]] == 0)
+					order.push_back(invSrc[i]);
+		if ((int)order.size() != liveCount)
+			RE("[Error] DFA::%s : The states which can reach an accept state form a cycle.", func);
+		std::vector<int>().swap(invSrc), std::vector<int>().swap(invBegin), std::vector<int>().swap(outDeg);
+		// a state's signature is its label and the (column, class) of its live targets
+		std::vector<int> ret(n, -1), represent;
+		auto same = [&](int u, int r) {
+			if (labelOf(u) != labelOf(r))
+				return false;
+			int e = begin[u], f = begin[r];
+			for (; ; ++e, ++f) {
+				while (e < begin[u + 1] && !live[edges[e].second])
+					++e;
+				while (f < begin[r + 1] && !live[edges[f].second])
+					++f;
+				if (e == begin[u + 1] || f == begin[r + 1])
+					return e == begin[u + 1] && f == begin[r + 1];
+				if (edges[e].first != edges[f].first || ret[edges[e].second] != ret[edges[f].second])
+					return false;
+			}
+		};
+		std::unordered_multimap<uint64_t, int> classOfHash;
+		classOfHash.reserve(liveCount);
+		for (int u : order) {
+			uint64_t h = (uint64_t)(unsigned)labelOf(u) * 0x9E3779B97F4A7C15ull;
+			for (int e = begin[u]; e < begin[u + 1]; ++e)
+				if (live[edges[e].second])
+					h = ((h ^ (uint64_t)edges[e].first) * 0x100000001B3ull ^ (uint64_t)ret[edges[e].second]) * 0x100000001B3ull;
+			auto range = classOfHash.equal_range(h);
+			for (auto it = range.first; it != range.second && ret[u] == -1; ++it)
+				if (same(u, represent[it->second]))
+					ret[u] = it->second;
+			if (ret[u] == -1) {
+				ret[u] = (int)represent.size();
+				classOfHash.emplace(h, ret[u]);
+				represent.push_back(u);
+			}
+		}
+		// numbered in order of appearance
+		std::vector<int> renumber(represent.size(), -1);
+		int cnt = 0;
+		for (int &x : ret)
+			if (x != -1) {
+				if (renumber[x] == -1)
+					renumber[x] = cnt++;
+				x = renumber[x];
+			}
+		return ret;
+	}
+	// Valmari and Lehtinen algorithm (2008) for partial automata
+	// O(t log n + m), with t = #defined transitions, n = #nodes, m = |alpabet|
+	// states that cannot reach an accept state are equivalent to the missing state and get -1,
+	// transitions into them are ignored, the other states get class ids from 0 in order of appearance
+	std::vector<int> equivalenceClassesValmari(const TransitionTable &tab) const {
+		NoStats stats;
+		return equivalenceClassesValmari(tab, stats);
+	}
+	template <typename Stats>
+	std::vector<int> equivalenceClassesValmari(const TransitionTable &tab, Stats &stats) const {
+		stats.phase(PhaseStart);
+		int m = tab.cols();
+		std::vector<int> ret(n, -1);
+		// states which can reach an accept state, by a backward search over the defined transitions
+		std::vector<int> revBegin(n + 1, 0);
+		for (int u = 0; u < n; ++u)
+			for (int j = 0; j < m; ++j) {
+				int v = tab.get(u, j);
+				if (v != -1)
+					++revBegin[v + 1];
+			}
+		for (int i = 0; i < n; ++i)
+			revBegin[i + 1] += revBegin[i];
+		std::vector<int> revSrc(revBegin[n]);
+		{
+			std::vector<int> fill(revBegin.begin(), revBegin.end() - 1);
+			for (int u = 0; u < n; ++u)
+				for (int j = 0; j < m; ++j) {
+					int v = tab.get(u, j);
+					if (v != -1)
+						revSrc[fill[v]++] = u;
+				}
+		}
+		std::vector<int> id(n, -1), useful;
+		for (int i = 0; i < n; ++i)
+			if (acceptStates[i])
+				id[i] = (int)useful.size(), useful.push_back(i);
+		for (int h = 0; h < (int)useful.size(); ++h) {
+			int v = useful[h];
+			for (int k = revBegin[v]; k < revBegin[v + 1]; ++k)
+				if (id[revSrc[k]] == -1)
+					id[revSrc[k]] = (int)useful.size(), useful.push_back(revSrc[k]);
+		}
+		std::vector<int>().swap(revBegin);
+		std::vector<int>().swap(revSrc);
+		int k = (int)useful.size();
+		if (k == 0)
+			return ret;
+		// transitions between useful states, grouped by label
+		std::vector<int> labelBegin(m + 1, 0);
+		for (int u : useful)
+			for (int j = 0; j < m; ++j) {
+				int v = tab.get(u, j);
+				if (v != -1 && id[v] != -1)
+					++labelBegin[j + 1];
+			}
+		for (int j = 0; j < m; ++j)
+			labelBegin[j + 1] += labelBegin[j];
+		int t = labelBegin[m];
+		std::vector<int> tail(t), head(t);
+		{
+			std::vector<int> fill(labelBegin.begin(), labelBegin.end() - 1);
+			for (int u : useful)
+				for (int j = 0; j < m; ++j) {
+					int v = tab.get(u, j);
+					if (v != -1 && id[v] != -1) {
+						int e = fill[j]++;
+						tail[e] = id[u], head[e] = id[v];
+					}
+				}
+		}
+		std::vector<int> M(std::max(k, t) + 1, 0), W(std::max(k, t) + 1);
+		int w = 0;
+		RefinablePartition B, C;
+		B.init(k);
+		{
+			// one block per label among the useful states
+			std::vector<int> groupOf;
+			int groups = labelGroups(groupOf);
+			std::vector<int> groupBegin(groups + 1, 0), byGroup(k);
+			for (int i = 0; i < k; ++i)
+				++groupBegin[groupOf[useful[i]] + 1];
+			for (int g = 0; g < groups; ++g)
+				groupBegin[g + 1] += groupBegin[g];
+			std::vector<int> pos(groupBegin.begin(), groupBegin.end() - 1);
+			for (int i = 0; i < k; ++i)
+				byGroup[pos[groupOf[useful[i]]]++] = i;
+			for (int g = 1; g < groups; ++g) {
+				for (int i = groupBegin[g]; i < groupBegin[g + 1]; ++i)
+					B.mark(byGroup[i], M, W, w);
+				B.split(M, W, w);
+			}
+		}
+		C.init(t);
+		C.z = 0;
+		for (int j = 0; j < m; ++j) {
+			if (labelBegin[j] == labelBegin[j + 1])
+				continue;
+			C.F[C.z] = labelBegin[j], C.P[C.z] = labelBegin[j + 1];
+			for (int e = labelBegin[j]; e < labelBegin[j + 1]; ++e)
+				C.S[e] = C.z;
+			++C.z;
+		}
+		// incoming transitions of every useful state
+		std::vector<int> inBegin(k + 1, 0), inTr(t);
+		for (int e = 0; e < t; ++e)
+			++inBegin[head[e] + 1];
+		for (int i = 0; i < k; ++i)
+			inBegin[i + 1] += inBegin[i];
+		{
+			std::vector<int> fill(inBegin.begin(), inBegin.end() - 1);
+			for (int e = 0; e < t; ++e)
+				inTr[fill[head[e]]++] = e;
+		}
+		stats.phase(PhaseInverse);
+		// every block after the first and every cord is a splitter once, in order of creation
+		int b = 1, c = 0;
+		for (int i = 0; i < B.z - 1 + C.z; ++i)
+			stats.push((size_t)i + 1);
+		while (c < C.z) {
+			for (int i = C.F[c]; i < C.P[c]; ++i)
+				B.mark(tail[C.E[i]], M, W, w);
+			stats.mark(C.P[c] - C.F[c]);
+			int cnt = B.split(M, W, w);
+			stats.split(cnt);
+			++c;
+			for (int i = 0; i < cnt; ++i)
+				stats.push((size_t)(B.z - b + C.z - c));
+			while (b < B.z) {
+				for (int i = B.F[b]; i < B.P[b]; ++i) {
+					int q = B.E[i];
+					stats.mark(inBegin[q + 1] - inBegin[q]);
+					for (int j = inBegin[q]; j < inBegin[q + 1]; ++j)
+						C.mark(inTr[j], M, W, w);
+				}
+				cnt = C.split(M, W, w);
+				stats.split(cnt);
+				++b;
+				for (int i = 0; i < cnt; ++i)
+					stats.push((size_t)(B.z - b + C.z - c));
+			}
+		}
+		stats.phase(PhaseRefine);
+		std::vector<int> classId(B.z, -1);
+		int classCnt = 0;
+		for (int i = 0; i < n; ++i) {
+			if (id[i] == -1)
+				continue;
+			int s = B.S[id[i]];
+			if (classId[s] == -1)
+				classId[s] = classCnt++;
+			ret[i] = classId[s];
+		}
+		stats.scratch((B.E.capacity() * 5 + C.E.capacity() * 5 + M.capacity() + W.capacity() + inBegin.capacity() + inTr.capacity()
+			+ tail.capacity() + head.capacity() + labelBegin.capacity() + id.capacity() + useful.capacity() + ret.capacity()) * sizeof(int));
+		stats.phase(PhaseCollect);
 		return ret;
 	}
 public:
+	// complete automata are minimized with Hopcroft's algorithm, partial ones with Valmari and Lehtinen's,
+	// where all states which cannot reach an accept state form one class
 	std::vector<int> equivalenceClasses() const {
+		NoStats stats;
+		return equivalenceClassesWith(stats);
+	}
+	std::vector<int> equivalenceClasses(MinimizationStats &stats) const {
+		StatsRecorder recorder(stats);
+		return equivalenceClassesWith(recorder);
+	}
+private:
+	template <typename Stats>
+	std::vector<int> equivalenceClassesWith(Stats &stats) const {
+		std::vector<int> classOf;
+		TransitionTable buffer;
+		const TransitionTable &tab = classTable(buffer, classOf);
+		stats.phase(PhaseStart);
+		stats.columns(n, tab.cols());
+//		return equivalenceClassesTableFilling(tab);
+		if (isComplete) {
+			std::vector<int> ret = equivalenceClassesHopcroft(tab, stats);
+			stats.classes(ret);
+			return ret;
+		}
+		std::vector<int> ret = equivalenceClassesValmari(tab, stats);
+		withDeadClass(ret);
+		stats.classes(ret);
+		return ret;
+	}
+	// the states without a class (-1) get one of their own, numbered in order of appearance with the others
+	static void withDeadClass(std::vector<int> &eqv) {
+		int deadClass = -1, seen = 0;
+		for (int &x : eqv) {
+			if (x == -1) {
+				if (deadClass == -1)
+					deadClass = seen;
+				x = deadClass;
+				continue;
+			}
+			seen = std::max(seen, x + 1);
+			if (deadClass != -1 && x >= deadClass)
+				++x;
+		}
+	}
+public:
+	// the two algorithms for complete automata on their own, to compare them
+	std::vector<int> equivalenceClassesHopcroft() const {
 		if (!isComplete)
-			RE("[Error] DFA::equivalenceClasses : Incomplete automaton.");
-//		return equivalenceClassesTableFilling();
-		return equivalenceClassesHopcroft();
+			RE("[Error] DFA::equivalenceClassesHopcroft : The automaton is not complete.");
+		std::vector<int> classOf;
+		TransitionTable buffer;
+		return equivalenceClassesHopcroft(classTable(buffer, classOf));
 	}
-	DeterministicFiniteAutomaton eliminateUnreachableStates(bool clearName = false) const {
+	std::vector<int> equivalenceClassesHopcroft(MinimizationStats &stats) const {
 		if (!isComplete)
-			RE("[Error] DFA::eliminateUnreachableStates : Incomplete automaton.");
+			RE("[Error] DFA::equivalenceClassesHopcroft : The automaton is not complete.");
+		std::vector<int> classOf;
+		TransitionTable buffer;
+		const TransitionTable &tab = classTable(buffer, classOf);
+		StatsRecorder recorder(stats);
+		recorder.columns(n, tab.cols());
+		std::vector<int> ret = equivalenceClassesHopcroft(tab, recorder);
+		recorder.classes(ret);
+		return ret;
+	}
+	std::vector<int> equivalenceClassesTableFilling() const {
+		if (!isComplete)
+			RE("[Error] DFA::equivalenceClassesTableFilling : The automaton is not complete.");
+		std::vector<int> classOf;
+		TransitionTable buffer;
+		return equivalenceClassesTableFilling(classTable(buffer, classOf));
+	}
+	// the same classes as equivalenceClasses(), with up to threads threads (0 for one per core):
+	// Moore's rounds in parallel while they beat the serial algorithm, which takes over with a parallel inverse otherwise
+	std::vector<int> equivalenceClassesParallel(int threads = 0) const {
+		if (threads <= 0)
+			threads = std::max(1, (int)std::thread::hardware_concurrency());
+		std::vector<int> classOf;
+		TransitionTable buffer;
+		std::vector<int> ret = parallelClasses(classTable(buffer, classOf), threads);
+		if (!isComplete)
+			withDeadClass(ret);
+		return ret;
+	}
+	// the classes of equivalenceClasses() for automata whose states that can reach an accept state form no cycle,
+	// such as dictionaries, in one pass over the table by Revuz's algorithm, fails on a cycle
+	std::vector<int> equivalenceClassesAcyclic() const {
+		std::vector<int> classOf;
+		TransitionTable buffer;
+		std::vector<int> ret = equivalenceClassesRevuz(classTable(buffer, classOf), "equivalenceClassesAcyclic");
+		withDeadClass(ret);
+		return ret;
+	}
+	DeterministicFiniteAutomaton eliminateUnreachableStates(bool clearName = false) const {
 		if (startStateIndex == -1)
 			RE("[Error] DFA::eliminateUnreachableStates : Start state unset.");
-		int m = sig.size();
-		std::vector<unsigned char> reachable(n, 0u);
-		std::vector<int> que(n);
-		int head = 0, tail = 1;
-		que[0] = startStateIndex;
-		reachable[startStateIndex] = 1u;
-		while (head != tail) {
-			int u = que[head++];
-			for (int j = 0; j < m; ++j) {
-				int v = transitions[u][j];
-				if (!reachable[v]) {
-					reachable[v] = 1u;
-					que[tail++] = v;
-				}
+		return eliminated(clearName, 1);
+	}
+private:
+	DeterministicFiniteAutomaton eliminated(bool clearName, int threads) const {
+		std::vector<int> map;
+		int newSize = reachableMap(map, threads);
+		DeterministicFiniteAutomaton ret = emptyLike(newSize);
+		for (int u = 0; u < n; ++u) if (map[u] != -1) {
+			if (isSparse) {
+				ret.sparseRows[map[u]] = sparseRows[u];
+				for (SparseRange &r : ret.sparseRows[map[u]])
+					r.to = map[r.to];
+				continue;
 			}
-		}
-		std::vector<int> map(n);
-		map[0] = 0;
-		for (int i = 1; i < n; ++i)
-			map[i] = map[i - 1] + (int)reachable[i - 1];
-		int newSize = map[n - 1] + (int)reachable[n - 1];
-		DeterministicFiniteAutomaton ret(sig);
-		ret.setSize(newSize);
-		for (int u = 0; u < n; ++u) if (reachable[u]) {
-			for (int j = 0; j < m; ++j) {
-				int v = transitions[u][j];
-				ret.transitions[map[u]][j] = map[v];
+			for (int c = 0; c < transitions.cols(); ++c) {
+				int v = transitions.get(u, c);
+				if (v != -1)
+					ret.transitions.set(map[u], c, map[v]);
 			}
 		}
-		ret.countEmptyTransitions = 0;
-		ret.isComplete = true;
-		for (int i = 0; i < n; ++i) if (reachable[i])
+		ret.countEmptyTransitions = ret.countEmptyEntries();
+		ret.isComplete = ret.countEmptyTransitions == 0;
+		for (int i = 0; i < n; ++i) if (map[i] != -1)
 			ret.acceptStates[map[i]] = acceptStates[i];
-		ret.startStateIndex = map[startStateIndex];
-		if (!clearName) {
-			for (int i = 0; i < n; ++i) if (reachable[i]) {
-				if (!stateNames[i].empty())
-					ret.stateNames[map[i]] = stateNames[i];
-				else
-					ret.stateNames[map[i]] = "q_" + std::to_string(i);
-			}
+		if (!acceptLabels.empty()) {
+			ret.acceptLabels.resize(newSize);
+			for (int i = 0; i < n; ++i) if (map[i] != -1)
+				ret.acceptLabels[map[i]] = acceptLabels[i];
 		}
+		ret.startStateIndex = map[startStateIndex];
+		if (!clearName)
+			ret.mergedNames = mergeNames(map, newSize, stateNames);
 		return ret;
 	}
-	DeterministicFiniteAutomaton minimize(bool clearName = false) const {
-		if (!isComplete)
-			RE("[Error] DFA::minimize : Incomplete automaton.");
+public:
+	// a partial automaton stays partial: states which cannot reach an accept state are dropped
+	// together with the transitions into them, unless the start state itself is one of them
+	// merged states get the names of their members joined with ", ", computed only when a name is asked for,
+	// clearName drops them and the names of the unreachable states
+	// a temporary (or std::move(A).minimize()) is minimized in its own buffers without a copy
+	DeterministicFiniteAutomaton minimize(bool clearName = false) const & {
 		if (startStateIndex == -1)
 			RE("[Error] DFA::minimize : Start state unset.");
-		int m = sig.size();
+		NoStats stats;
+		DeterministicFiniteAutomaton A = eliminateUnreachableStates(clearName);
+		A.minimizeReachable(stats, clearName);
+		return A;
+	}
+	DeterministicFiniteAutomaton minimize(bool clearName = false) && {
+		if (startStateIndex == -1)
+			RE("[Error] DFA::minimize : Start state unset.");
+		NoStats stats;
+		eliminateInPlace(clearName);
+		minimizeReachable(stats, clearName);
+		return std::move(*this);
+	}
+	// stats are those of the refinement on the reachable part
+	DeterministicFiniteAutomaton minimize(MinimizationStats &stats, bool clearName = false) const & {
+		if (startStateIndex == -1)
+			RE("[Error] DFA::minimize : Start state unset.");
+		StatsRecorder recorder(stats);
+		DeterministicFiniteAutomaton A = eliminateUnreachableStates(clearName);
+		A.minimizeReachable(recorder, clearName);
+		return A;
+	}
+	DeterministicFiniteAutomaton minimize(MinimizationStats &stats, bool clearName = false) && {
+		if (startStateIndex == -1)
+			RE("[Error] DFA::minimize : Start state unset.");
+		StatsRecorder recorder(stats);
+		eliminateInPlace(clearName);
+		minimizeReachable(recorder, clearName);
+		return std::move(*this);
+	}
+	// minimize with up to threads threads (0 for one per core), the result is the same as minimize's:
+	// a level-synchronous search for the reachable states, then equivalenceClassesParallel
+	DeterministicFiniteAutomaton minimizeParallel(int threads = 0, bool clearName = false) const & {
+		if (startStateIndex == -1)
+			RE("[Error] DFA::minimizeParallel : Start state unset.");
+		if (threads <= 0)
+			threads = std::max(1, (int)std::thread::hardware_concurrency());
+		NoStats stats;
+		DeterministicFiniteAutomaton A = eliminated(clearName, threads);
+		A.minimizeReachable(stats, clearName, threads);
+		return A;
+	}
+	DeterministicFiniteAutomaton minimizeParallel(int threads = 0, bool clearName = false) && {
+		if (startStateIndex == -1)
+			RE("[Error] DFA::minimizeParallel : Start state unset.");
+		if (threads <= 0)
+			threads = std::max(1, (int)std::thread::hardware_concurrency());
+		NoStats stats;
+		eliminateInPlace(clearName, threads);
+		minimizeReachable(stats, clearName, threads);
+		return std::move(*this);
+	}
+	// minimize for automata whose states that can reach an accept state form no cycle, with the same result,
+	// by equivalenceClassesAcyclic in time linear in the table, fails on a cycle
+	DeterministicFiniteAutomaton minimizeAcyclic(bool clearName = false) const & {
+		if (startStateIndex == -1)
+			RE("[Error] DFA::minimizeAcyclic : Start state unset.");
+		NoStats stats;
 		DeterministicFiniteAutomaton A = eliminateUnreachableStates(clearName);
-		int oldSize = A.size();
-		std::vector<int> eqv = A.equivalenceClasses();
+		A.minimizeReachable(stats, clearName, 1, true);
+		return A;
+	}
+	DeterministicFiniteAutomaton minimizeAcyclic(bool clearName = false) && {
+		if (startStateIndex == -1)
+			RE("[Error] DFA::minimizeAcyclic : Start state unset.");
+		NoStats stats;
+		eliminateInPlace(clearName);
+		minimizeReachable(stats, clearName, 1, true);
+		return std::move(*this);
+	}
+private:
+	// map[u] = index of state u among the states reachable from the start state in their order, -1 if unreachable
+	int reachableMap(std::vector<int> &map, int threads = 1) const {
+		std::vector<unsigned char> reachable(n, 0u);
+		if (threads > 1)
+			reachableParallel(reachable, threads);
+		else {
+			std::vector<int> que(n);
+			int head = 0, tail = 1;
+			que[0] = startStateIndex;
+			reachable[startStateIndex] = 1u;
+			while (head != tail) {
+				int u = que[head++];
+				forEachTarget(u, [&](int v) {
+					if (!reachable[v]) {
+						reachable[v] = 1u;
+						que[tail++] = v;
+					}
+				});
+			}
+		}
+		map.assign(n, -1);
+		int k = 0;
+		for (int u = 0; u < n; ++u)
+			if (reachable[u])
+				map[u] = k++;
+		return k;
+	}
+	// level-synchronous breadth first search, the frontier is cut into one part per thread and a state goes
+	// to the next frontier of the thread which claims it first, small frontiers are expanded by the calling thread alone
+	void reachableParallel(std::vector<unsigned char> &reachable, int threads) const {
+		std::unique_ptr<std::atomic<unsigned char>[]> seen(new std::atomic<unsigned char>[n]);
+		for (int u = 0; u < n; ++u)
+			seen[u].store(0u, std::memory_order_relaxed);
+		std::vector<int> frontier(1, startStateIndex);
+		std::vector<std::vector<int>> found(threads);
+		seen[startStateIndex].store(1u, std::memory_order_relaxed);
+		const size_t minPart = 1024;
+		while (!frontier.empty()) {
+			int parts = (int)std::min((size_t)threads, (frontier.size() + minPart - 1) / minPart);
+			auto expand = [&](int t) {
+				std::vector<int> &out = found[t];
+				out.clear();
+				size_t lo = frontier.size() * t / parts, hi = frontier.size() * (t + 1) / parts;
+				for (size_t i = lo; i < hi; ++i)
+					forEachTarget(frontier[i], [&](int v) {
+						if (!seen[v].load(std::memory_order_relaxed) && !seen[v].exchange(1u, std::memory_order_relaxed))
+							out.push_back(v);
+					});
+			};
+			runThreads(parts, expand);
+			frontier.clear();
+			for (int t = 0; t < parts; ++t)
+				frontier.insert(frontier.end(), found[t].begin(), found[t].end());
+		}
+		for (int u = 0; u < n; ++u)
+			reachable[u] = seen[u].load(std::memory_order_relaxed);
+	}
+	// eliminateUnreachableStates on this automaton, every row moves down to its new index
+	void eliminateInPlace(bool clearName, int threads = 1) {
+		std::vector<int> map;
+		int newSize = reachableMap(map, threads);
+		for (int u = 0; u < n; ++u) {
+			int nu = map[u];
+			if (nu == -1)
+				continue;
+			if (isSparse) {
+				for (SparseRange &r : sparseRows[u])
+					r.to = map[r.to];
+				if (nu != u)
+					sparseRows[nu] = std::move(sparseRows[u]);
+			}
+			else
+				for (int c = 0; c < transitions.cols(); ++c) {
+					int v = transitions.get(u, c);
+					transitions.set(nu, c, v == -1 ? -1 : map[v]);
+				}
+			acceptStates[nu] = acceptStates[u];
+			if (!acceptLabels.empty())
+				acceptLabels[nu] = acceptLabels[u];
+		}
+		if (clearName)
+			mergedNames.reset();
+		else
+			mergedNames = mergeNames(map, newSize, std::move(stateNames));
+		shrinkStates(newSize);
+		startStateIndex = map[startStateIndex];
+	}
+	// keeps the first siz states, without names
+	void shrinkStates(int siz) {
+		if (isSparse)
+			sparseRows.resize(siz);
+		else
+			transitions.truncate(siz);
+		acceptStates.resize(siz);
+		if (!acceptLabels.empty())
+			acceptLabels.resize(siz);
+		stateNames.clear();
+		stateNames.resize(siz);
+		n = siz;
+		countEmptyTransitions = countEmptyEntries();
+		isComplete = countEmptyTransitions == 0;
+	}
+	// the rest of minimize once every state is reachable, the classes are written over the rows in place:
+	// classes are numbered in order of their first state, so the row of class i is read from a row at i or later
+	template <typename Stats>
+	void minimizeReachable(Stats &stats, bool clearName, int threads = 1, bool acyclic = false) {
+		int oldSize = n;
+		std::vector<int> classOf;
+		TransitionTable buffer;
+		const TransitionTable &tab = classTable(buffer, classOf);
+		stats.columns(oldSize, tab.cols());
+		std::vector<int> eqv;
+		if (acyclic) {
+			eqv = equivalenceClassesRevuz(tab, "minimizeAcyclic");
+			// a complete automaton keeps its dead states as one class, as Hopcroft's algorithm does
+			if (isComplete)
+				withDeadClass(eqv);
+		}
+		else if (threads > 1)
+			eqv = parallelClasses(tab, threads);
+		else
+			eqv = isComplete ? equivalenceClassesHopcroft(tab, stats) : equivalenceClassesValmari(tab, stats);
+		buffer.clear();
+		if (eqv[startStateIndex] == -1)
+			for (int &x : eqv)
+				x = x == -1 ? 0 : -1; // empty language, only the start state's class is kept
 		int newSize = *std::max_element(eqv.begin(), eqv.end()) + 1;
-		DeterministicFiniteAutomaton ret(sig);
-		ret.setSize(newSize);
 		std::vector<int> represent(newSize, -1);
 		for (int i = 0; i < oldSize; ++i)
-			if (represent[eqv[i]] == -1)
+			if (eqv[i] != -1 && represent[eqv[i]] == -1)
 				represent[eqv[i]] = i;
+		std::vector<SparseRange> row;
 		for (int i = 0; i < newSize; ++i) {
 			int u = represent[i];
-			for (int j = 0; j < m; ++j) {
-				int v = A.transitions[u][j];
-				ret.transitions[i][j] = eqv[v];
+			if (isSparse) {
+				row.clear();
+				for (const SparseRange &r : sparseRows[u]) {
+					int v = eqv[r.to];
+					if (v == -1)
+						continue;
+					if (!row.empty() && row.back().hi + 1 == r.lo && row.back().to == v)
+						row.back().hi = r.hi;
+					else
+						row.push_back({r.lo, r.hi, v});
+				}
+				sparseRows[i].assign(row.begin(), row.end());
+				sparseRows[i].shrink_to_fit();
+			}
+			else
+				for (int c = 0; c < transitions.cols(); ++c) {
+					int v = transitions.get(u, c);
+					transitions.set(i, c, v == -1 ? -1 : eqv[v]);
+				}
+			acceptStates[i] = acceptStates[u];
+			if (!acceptLabels.empty())
+				acceptLabels[i] = acceptLabels[u];
+		}
+		int start = eqv[startStateIndex];
+		if (clearName)
+			mergedNames.reset();
+		else
+			mergedNames = mergeNames(eqv, newSize, std::move(stateNames));
+		shrinkStates(newSize);
+		startStateIndex = start;
+		stats.classes(eqv);
+	}
+public:
+	// renumbering for locality of the table rows, nothing else changes and no state is dropped,
+	// (*mapping)[u] receives the new index of state u
+	enum StateOrder {
+		BreadthFirst, DepthFirst
+	};
+	// states reachable from the start state first, in breadth first or depth first preorder
+	DeterministicFiniteAutomaton reorder(StateOrder order, std::vector<int> *mapping = nullptr) const {
+		if (n == 0)
+			RE("[Error] DFA::reorder : Empty automaton.");
+		return reordered(traversal(order == DepthFirst), mapping);
+	}
+	// most visited states of the profile first, ties and unvisited states in breadth first order
+	DeterministicFiniteAutomaton reorder(const MatchProfile &prof, std::vector<int> *mapping = nullptr) const {
+		if (n == 0)
+			RE("[Error] DFA::reorder : Empty automaton.");
+		if ((int)prof.visits.size() != n)
+			RE("[Error] DFA::reorder : The profile was taken on another automaton.");
+		std::vector<int> order = traversal(false);
+		std::stable_sort(order.begin(), order.end(), [&prof](int a, int b) {
+			return prof.visits[a] > prof.visits[b];
+		});
+		return reordered(order, mapping);
+	}
+	// boolean operations on the languages of two automata over the same alphabet, see product,
+	// minimized output is minimized with cleared names, otherwise all states get default names
+	DeterministicFiniteAutomaton intersection(const DeterministicFiniteAutomaton &other, bool minimized = false) const {
+		return product(other, 0x8, minimized, "intersection");
+	}
+	DeterministicFiniteAutomaton unionWith(const DeterministicFiniteAutomaton &other, bool minimized = false) const {
+		return product(other, 0xE, minimized, "unionWith");
+	}
+	DeterministicFiniteAutomaton difference(const DeterministicFiniteAutomaton &other, bool minimized = false) const {
+		return product(other, 0x4, minimized, "difference");
+	}
+	DeterministicFiniteAutomaton symmetricDifference(const DeterministicFiniteAutomaton &other, bool minimized = false) const {
+		return product(other, 0x6, minimized, "symmetricDifference");
+	}
+	// binary image read back by load or mapped in place by DeterministicFiniteAutomatonView,
+	// the alphabet is kept as its symbol list, state names only when withNames is set
+	void save(const std::string &path, bool withNames = true) const;
+	static DeterministicFiniteAutomaton load(const std::string &path);
+	// whether both automata accept the same language, decided by Hopcroft and Karp's union-find over state pairs,
+	// which stops at the first pair with different acceptance,
+	// a shortest word accepted by exactly one of them is stored in counterexample when they differ,
+	// accept labels are not compared
+	bool equivalent(const DeterministicFiniteAutomaton &other, std::vector<int> *counterexample = nullptr) const {
+		JointClasses jc;
+		jointClasses(other, jc, "equivalent");
+		int k = jc.size();
+		// nodes are the states of this, its dead state, the states of other and its dead state
+		int total = n + other.n + 2;
+		std::vector<int> parent(total), weight(total, 1);
+		for (int i = 0; i < total; ++i)
+			parent[i] = i;
+		auto find = [&](int x) {
+			while (parent[x] != x)
+				x = parent[x] = parent[parent[x]];
+			return x;
+		};
+		auto unite = [&](int p, int q) {
+			int a = find(p == -1 ? n : p), b = find(q == -1 ? total - 1 : n + 1 + q);
+			if (a == b)
+				return false;
+			if (weight[a] < weight[b])
+				std::swap(a, b);
+			parent[b] = a;
+			weight[a] += weight[b];
+			return true;
+		};
+		std::vector<int> queA(1, startStateIndex), queB(1, other.startStateIndex);
+		unite(startStateIndex, other.startStateIndex);
+		bool same = true;
+		for (size_t h = 0; same && h < queA.size(); ++h) {
+			int p = queA[h], q = queB[h];
+			if ((p != -1 && acceptStates[p]) != (q != -1 && other.acceptStates[q])) {
+				same = false;
+				break;
+			}
+			for (int c = 0; c < k; ++c) {
+				int p2 = jc.stepA(p, c), q2 = jc.stepB(q, c);
+				if (unite(p2, q2)) {
+					queA.push_back(p2);
+					queB.push_back(q2);
+				}
+			}
+		}
+		if (!same && counterexample)
+			pairWitness(other, jc, 0x6, counterexample);
+		return same;
+	}
+	// whether every word accepted by other is accepted by this automaton,
+	// a shortest word accepted by other only is stored in counterexample otherwise
+	bool includes(const DeterministicFiniteAutomaton &other, std::vector<int> *counterexample = nullptr) const {
+		JointClasses jc;
+		jointClasses(other, jc, "includes");
+		return !pairWitness(other, jc, 0x2, counterexample);
+	}
+	// only the accept states are flipped when the automaton is complete,
+	// otherwise all empty transitions go to a new accepting sink first, accept labels are dropped
+	DeterministicFiniteAutomaton complement() const {
+		if (n == 0)
+			RE("[Error] DFA::complement : Empty automaton.");
+		if (sig.empty())
+			RE("[Error] DFA::complement : Empty alphabet.");
+		if (isComplete) {
+			DeterministicFiniteAutomaton ret(*this);
+			for (unsigned char &x : ret.acceptStates)
+				x = !x;
+			ret.acceptLabels.clear();
+			return ret;
+		}
+		int m = sig.size();
+		DeterministicFiniteAutomaton ret = emptyLike(n + 1);
+		for (int u = 0; u <= n; ++u) {
+			if (isSparse) {
+				std::vector<SparseRange> &row = ret.sparseRows[u];
+				int next = 0;
+				if (u < n)
+					for (const SparseRange &r : sparseRows[u]) {
+						if (next < r.lo)
+							row.push_back({next, r.lo - 1, n});
+						row.push_back(r);
+						next = r.hi + 1;
+					}
+				if (next < m)
+					row.push_back({next, m - 1, n});
+				row.shrink_to_fit();
+				continue;
+			}
+			for (int c = 0; c < transitions.cols(); ++c) {
+				int v = u < n ? transitions.get(u, c) : -1;
+				ret.transitions.set(u, c, v == -1 ? n : v);
 			}
 		}
 		ret.countEmptyTransitions = 0;
 		ret.isComplete = true;
-		for (int i = 0; i < newSize; ++i)
-			ret.acceptStates[i] = A.acceptStates[represent[i]];
-		ret.startStateIndex = eqv[A.startStateIndex];
-		if (!clearName) {
-			for (int i = 0; i < oldSize; ++i) {
-				if (ret.stateNames[eqv[i]].empty())
-					ret.stateNames[eqv[i]] = A.stateNames[i];
-				else
-					(ret.stateNames[eqv[i]] += ", ") += A.stateNames[i];
-			}
+		for (int u = 0; u < n; ++u) {
+			ret.acceptStates[u] = !acceptStates[u];
+			ret.stateNames[u] = stateNames[u];
 		}
+		ret.mergedNames = mergedNames;
+		ret.acceptStates[n] = 1u;
+		ret.startStateIndex = startStateIndex;
 		return ret;
 	}
 	~DeterministicFiniteAutomaton() = default;
@@ -671,6 +3406,762 @@ DeterministicFiniteAutomaton::State DeterministicFiniteAutomaton::State::transit
 bool DeterministicFiniteAutomaton::State::accept() const {
 	return this->DFA().isAcceptState(*this);
 }
+int DeterministicFiniteAutomaton::State::label() const {
+	return this->DFA().acceptLabel(*this);
+}
+DeterministicFiniteAutomaton::Matcher::Matcher(const DeterministicFiniteAutomaton &dfa) : orig(&dfa), ind(dfa.start().index()), cnt(0ull) {
+	if (orig->alphabetEmpty())
+		RE("[Error] DFA::Matcher : Empty alphabet");
+}
+DeterministicFiniteAutomaton::Matcher::Matcher(const State &state) : orig(&state.DFA()), ind(state.index()), cnt(0ull) {
+	if (orig->empty())
+		RE("[Error] DFA::Matcher : Empty automaton.");
+	if (orig->alphabetEmpty())
+		RE("[Error] DFA::Matcher : Empty alphabet");
+}
+void DeterministicFiniteAutomaton::Matcher::reset() {
+	ind = orig->start().index();
+	cnt = 0ull;
+}
+void DeterministicFiniteAutomaton::Matcher::reset(const State &state) {
+	if (orig != &state.DFA())
+		RE("[Error] DFA::Matcher::reset : State\'s original automaton is not this one.");
+	ind = state.index();
+	cnt = 0ull;
+}
+DeterministicFiniteAutomaton::Matcher &DeterministicFiniteAutomaton::Matcher::feed(int symbol) {
+	ind = orig->runSymbols(ind, &symbol, &symbol + 1);
+	++cnt;
+	return *this;
+}
+DeterministicFiniteAutomaton::Matcher &DeterministicFiniteAutomaton::Matcher::feed(const char *first, const char *last) {
+	ind = orig->runSymbols(ind, first, last);
+	cnt += (unsigned long long)(last - first);
+	return *this;
+}
+DeterministicFiniteAutomaton::Matcher &DeterministicFiniteAutomaton::Matcher::feed(const char *buffer, size_t length) {
+	return feed(buffer, buffer + length);
+}
+DeterministicFiniteAutomaton::Matcher &DeterministicFiniteAutomaton::Matcher::feed(const std::string &symbString) {
+	return feed(symbString.data(), symbString.data() + symbString.length());
+}
+#if __cplusplus >= 201703L
+DeterministicFiniteAutomaton::Matcher &DeterministicFiniteAutomaton::Matcher::feed(std::string_view symbString) {
+	return feed(symbString.data(), symbString.data() + symbString.length());
+}
+#endif
+DeterministicFiniteAutomaton::Matcher &DeterministicFiniteAutomaton::Matcher::feed(std::istream &in) {
+	std::vector<char> buffer(1 << 16);
+	while (in) {
+		in.read(buffer.data(), (std::streamsize)buffer.size());
+		std::streamsize got = in.gcount();
+		if (got <= 0)
+			break;
+		feed(buffer.data(), buffer.data() + got);
+	}
+	return *this;
+}
+DeterministicFiniteAutomaton::Matcher &DeterministicFiniteAutomaton::Matcher::feedFile(const std::string &path) {
+#if defined(__unix__) || defined(__APPLE__)
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd == -1)
+		RE("[Error] DFA::Matcher::feedFile : Cannot open file \'%s\'.", path.c_str());
+	struct stat st;
+	if (::fstat(fd, &st) == -1)
+		RE("[Error] DFA::Matcher::feedFile : Cannot stat file \'%s\'.", path.c_str());
+	size_t length = (size_t)st.st_size;
+	if (length != 0) {
+		void *addr = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (addr == MAP_FAILED)
+			RE("[Error] DFA::Matcher::feedFile : Cannot map file \'%s\'.", path.c_str());
+		::madvise(addr, length, MADV_SEQUENTIAL);
+		const char *data = (const char *)addr;
+		feed(data, data + length);
+		::munmap(addr, length);
+	}
+	::close(fd);
+#else
+	std::ifstream in(path, std::ios::binary);
+	if (!in)
+		RE("[Error] DFA::Matcher::feedFile : Cannot open file \'%s\'.", path.c_str());
+	feed(in);
+#endif
+	return *this;
+}
+bool DeterministicFiniteAutomaton::Matcher::accept() const {
+	if (ind == -1)
+		return false;
+	return orig->isAcceptState(State(*orig, ind));
+}
+int DeterministicFiniteAutomaton::Matcher::label() const {
+	if (ind == -1)
+		return -1;
+	return orig->labelOf(ind);
+}
+DeterministicFiniteAutomaton::State DeterministicFiniteAutomaton::Matcher::state() const {
+	if (ind == -1)
+		return orig->invalid();
+	return State(*orig, ind);
+}
+DeterministicFiniteAutomaton::Searcher::Searcher(const DeterministicFiniteAutomaton &dfa, int stateLimit) : cols(0), anchoredStart(-1) {
+	if (dfa.empty())
+		RE("[Error] DFA::searcher : Empty automaton.");
+	if (dfa.alphabetEmpty())
+		RE("[Error] DFA::searcher : Empty alphabet");
+	std::vector<int> classOf;
+	TransitionTable buffer;
+	const TransitionTable &tab = dfa.classTable(buffer, classOf);
+	int n = dfa.n, m = dfa.sig.size(), k = tab.cols();
+	cols = k + 1;
+	std::vector<std::vector<int>> classBytes(cols);
+	for (int b = 0; b < 256; ++b) {
+		int symbId = dfa.sig.lookup((int)(char)b);
+		byteClass[b] = symbId >= 0 && symbId < m ? classOf[symbId] : k;
+		classBytes[byteClass[b]].push_back(b);
+	}
+	std::vector<unsigned char> live = dfa.liveStates(tab);
+	if (dfa.startStateIndex != -1 && live[dfa.startStateIndex])
+		anchoredStart = dfa.startStateIndex;
+	anchoredTable.reset(n, cols);
+	anchoredAccept = dfa.acceptStates;
+	for (int u = 0; u < n; ++u)
+		for (int c = 0; live[u] && c < k; ++c) {
+			int v = tab.get(u, c);
+			if (v != -1 && live[v])
+				anchoredTable.set(u, c, v);
+		}
+	// subset construction, the start state joins every set
+	struct SetHash {
+		size_t operator () (const std::vector<int> &set) const {
+			uint64_t h = set.size();
+			for (int q : set)
+				h = (h ^ (uint64_t)q) * 0x100000001B3ull;
+			return (size_t)h;
+		}
+	};
+	std::unordered_map<std::vector<int>, int, SetHash> index;
+	std::vector<std::vector<int>> sets(1);
+	std::vector<int> rows, target;
+	if (anchoredStart != -1)
+		sets[0].push_back(anchoredStart);
+	index.emplace(sets[0], 0);
+	scanAccept.push_back(anchoredStart != -1 && anchoredAccept[anchoredStart]);
+	for (size_t s = 0; s < sets.size(); ++s) {
+		for (int c = 0; c < k; ++c) {
+			target.clear();
+			if (anchoredStart != -1)
+				target.push_back(anchoredStart);
+			for (int q : sets[s]) {
+				int v = anchoredTable.get(q, c);
+				if (v != -1)
+					target.push_back(v);
+			}
+			std::sort(target.begin(), target.end());
+			target.erase(std::unique(target.begin(), target.end()), target.end());
+			std::unordered_map<std::vector<int>, int, SetHash>::const_iterator it = index.find(target);
+			if (it != index.end()) {
+				rows.push_back(it->second);
+				continue;
+			}
+			int t = (int)sets.size();
+			if (t >= stateLimit)
+				RE("[Error] DFA::searcher : More than %d states.", stateLimit);
+			unsigned char acc = 0u;
+			for (int q : target)
+				acc |= anchoredAccept[q];
+			sets.push_back(target);
+			index.emplace(target, t);
+			scanAccept.push_back(acc);
+			rows.push_back(t);
+		}
+		rows.push_back(0);
+		std::vector<int>().swap(sets[s]);
+	}
+	int cnt = (int)sets.size();
+	scanTable.reset(cnt, cols);
+	for (int s = 0; s < cnt; ++s)
+		for (int c = 0; c < cols; ++c)
+			scanTable.set(s, c, rows[(size_t)s * cols + c]);
+	exitsOf(scanTable, classBytes, scanExits);
+	for (int s = 0; s < cnt; ++s)
+		if (scanAccept[s])
+			scanExits[s].count = -1;
+	exitsOf(anchoredTable, classBytes, anchoredExits);
+	// a nonempty match begins with a byte whose transition from the start state is live
+	startExits.count = 0;
+	for (int b = 0; b < 256; ++b) {
+		startLive[b] = anchoredStart != -1 && anchoredTable.get(anchoredStart, byteClass[b]) != -1;
+		if (startLive[b] && startExits.count != -1) {
+			if (startExits.count == 3)
+				startExits.count = -1;
+			else
+				startExits.bytes[startExits.count++] = (unsigned char)b;
+		}
+	}
+}
+void DeterministicFiniteAutomaton::Searcher::exitsOf(const TransitionTable &tab, const std::vector<std::vector<int>> &classBytes, std::vector<Exits> &exits) const {
+	int rows = tab.rows();
+	exits.assign(rows, Exits());
+	for (int u = 0; u < rows; ++u) {
+		Exits &e = exits[u];
+		e.count = 0;
+		for (int c = 0; c < cols && e.count != -1; ++c) {
+			if (tab.get(u, c) == u)
+				continue;
+			if (e.count + (int)classBytes[c].size() > 3)
+				e.count = -1;
+			else
+				for (int b : classBytes[c])
+					e.bytes[e.count++] = (unsigned char)b;
+		}
+	}
+}
+// first position in [p, last) holding one of the exit bytes, last if none
+const char *DeterministicFiniteAutomaton::Searcher::skip(const char *p, const char *last, const Exits &e) {
+	if (e.count == 0)
+		return last;
+	if (e.count == 1) {
+		const void *q = std::memchr(p, e.bytes[0], (size_t)(last - p));
+		return q ? (const char *)q : last;
+	}
+	unsigned char b0 = e.bytes[0], b1 = e.bytes[1], b2 = e.bytes[e.count - 1];
+#ifdef __SSE2__
+	__m128i v0 = _mm_set1_epi8((char)b0), v1 = _mm_set1_epi8((char)b1), v2 = _mm_set1_epi8((char)b2);
+	for (; last - p >= 16; p += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i *)p);
+		__m128i eq = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, v0), _mm_cmpeq_epi8(x, v1)), _mm_cmpeq_epi8(x, v2));
+		unsigned mask = (unsigned)_mm_movemask_epi8(eq);
+		if (mask) {
+			while (!(mask & 1u))
+				mask >>= 1, ++p;
+			return p;
+		}
+	}
+#endif
+	for (; p != last; ++p) {
+		unsigned char b = (unsigned char)*p;
+		if (b == b0 || b == b1 || b == b2)
+			return p;
+	}
+	return last;
+}
+const char *DeterministicFiniteAutomaton::Searcher::firstEnd(const char *first, const char *last) const {
+	if (scanTable.width() == 1)
+		return scanFirstEnd(DenseStepper<uint8_t>(scanTable.data8(), nullptr, cols), first, last);
+	if (scanTable.width() == 2)
+		return scanFirstEnd(DenseStepper<uint16_t>(scanTable.data16(), nullptr, cols), first, last);
+	return scanFirstEnd(DenseStepper<uint32_t>(scanTable.data32(), nullptr, cols), first, last);
+}
+const char *DeterministicFiniteAutomaton::Searcher::longest(const char *first, const char *last) const {
+	if (anchoredTable.width() == 1)
+		return scanLongest(DenseStepper<uint8_t>(anchoredTable.data8(), nullptr, cols), first, last);
+	if (anchoredTable.width() == 2)
+		return scanLongest(DenseStepper<uint16_t>(anchoredTable.data16(), nullptr, cols), first, last);
+	return scanLongest(DenseStepper<uint32_t>(anchoredTable.data32(), nullptr, cols), first, last);
+}
+DeterministicFiniteAutomaton::Tokenizer::Tokenizer(const DeterministicFiniteAutomaton &dfa) : cols(0), start(-1) {
+	if (dfa.empty())
+		RE("[Error] DFA::tokenizer : Empty automaton.");
+	if (dfa.alphabetEmpty())
+		RE("[Error] DFA::tokenizer : Empty alphabet");
+	if (dfa.startStateIndex == -1)
+		RE("[Error] DFA::tokenizer : Start state unset.");
+	std::vector<int> classOf;
+	TransitionTable buffer;
+	const TransitionTable &tab = dfa.classTable(buffer, classOf);
+	int n = dfa.n, m = dfa.sig.size(), k = tab.cols();
+	cols = k + 1;
+	for (int b = 0; b < 256; ++b) {
+		int symbId = dfa.sig.lookup((int)(char)b);
+		byteClass[b] = symbId >= 0 && symbId < m ? classOf[symbId] : k;
+	}
+	std::vector<unsigned char> live = dfa.liveStates(tab);
+	if (live[dfa.startStateIndex])
+		start = dfa.startStateIndex;
+	table.reset(n, cols);
+	labels.resize(n);
+	for (int u = 0; u < n; ++u) {
+		labels[u] = dfa.labelOf(u);
+		for (int c = 0; live[u] && c < k; ++c) {
+			int v = tab.get(u, c);
+			if (v != -1 && live[v])
+				table.set(u, c, v);
+		}
+	}
+}
+const char *DeterministicFiniteAutomaton::Tokenizer::next(const char *first, const char *last, int &label) const {
+	if (table.width() == 1)
+		return scan(DenseStepper<uint8_t>(table.data8(), nullptr, cols), first, last, label);
+	if (table.width() == 2)
+		return scan(DenseStepper<uint16_t>(table.data16(), nullptr, cols), first, last, label);
+	return scan(DenseStepper<uint32_t>(table.data32(), nullptr, cols), first, last, label);
+}
+int DeterministicFiniteAutomaton::Searcher::acceleratedStates() const {
+	int ret = 0;
+	for (const Exits &e : scanExits)
+		ret += e.count != -1;
+	for (const Exits &e : anchoredExits)
+		ret += e.count != -1;
+	return ret;
+}
+
+// read-only automaton over a file written by DeterministicFiniteAutomaton::save,
+// the file is memory mapped and its tables are used in place without copying
+// layout: a fixed header, then sections aligned to 64 bytes, native byte order
+class DeterministicFiniteAutomatonView {
+public:
+	enum Section {
+		Symbols, // int32[m], symbol of every id
+		SortedSymbols, // int32[m][2], (symbol, id) sorted by symbol
+		Lookup, // int32[lutSize], ids of symbols lutLow.. as in Alphabet, -1 for symbols out of it
+		Accept, // uint64[(n + 63) / 64], accept bits
+		Columns, // int32[m], table column of every id once the alphabet is compressed
+		Table, // dense: n * columns entries of width bytes, sparse: uint64[n + 1], first range of every state
+		Ranges, // sparse only: int32[][3], (lo, hi, to) ranges of symbol ids
+		NameIndex, // uint64[n + 1], offsets of the state names
+		NameData, // state names back to back
+		Labels, // int32[n], accept label of every state, only when some are set
+		SectionCount
+	};
+	struct Header {
+		char magic[8];
+		uint32_t version, byteOrder, flags;
+		int32_t states, symbols, columns, width, start, lutLow, lutSize;
+		uint64_t fileSize, checksum;
+		uint64_t offset[SectionCount], length[SectionCount];
+	};
+	static const uint32_t currentVersion = 2u;
+	static const uint32_t flagSparse = 1u, flagNames = 2u;
+	static const char *magicBytes() {
+		return "PRDFA\r\n\x1a";
+	}
+	// FNV-1a style hash over 64-bit words, the checksum field itself counts as zero
+	static uint64_t checksum(const char *data, size_t length) {
+		uint64_t h = 1469598103934665603ull;
+		for (size_t i = 0; i < length; i += 8) {
+			uint64_t word;
+			std::memcpy(&word, data + i, 8);
+			if (i == offsetof(Header, checksum))
+				word = 0;
+			h = (h ^ word) * 1099511628211ull;
+			h ^= h >> 29;
+		}
+		return h;
+	}
+private:
+	const char *base;
+	size_t length;
+	std::vector<uint64_t> buffer; // file contents when it cannot be mapped
+	const Header *head;
+	const int32_t *symbolData, *sortedData, *lookupData, *columnData, *rangeData, *labelData;
+	const uint64_t *acceptData, *rowData, *nameIndex;
+	const char *tableData, *nameData;
+	const char *section(int sec) const {
+		return head->length[sec] ? base + head->offset[sec] : nullptr;
+	}
+	void validate(const std::string &path, bool verify);
+	// one pass over every section, symbol ids, columns, targets, ranges, names and labels in range
+	void validateContents(const std::string &path) const;
+	template <typename T>
+	int runDense(int index, const char *first, const char *last) const {
+		const T *tab = (const T *)tableData;
+		int cols = head->columns;
+		for (; first != last; ++first) {
+			int symbId = symbolIdChecked((int)*first);
+			if (index == -1)
+				continue;
+			T next = tab[(size_t)index * cols + (columnData ? columnData[symbId] : symbId)];
+			index = next == (T)~(T)0 ? -1 : (int)next;
+		}
+		return index;
+	}
+	int sparseGet(int index, int symbId) const {
+		uint64_t lo = rowData[index], hi = rowData[index + 1];
+		while (lo < hi) {
+			uint64_t mid = lo + (hi - lo) / 2;
+			if (rangeData[mid * 3] <= symbId)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		if (lo == rowData[index] || rangeData[(lo - 1) * 3 + 1] < symbId)
+			return -1;
+		return rangeData[(lo - 1) * 3 + 2];
+	}
+	int symbolIdChecked(int c) const {
+		int symbId = symbolId(c);
+		if (symbId == -1)
+			RE("[Error] DFA::View : Invalid symbol \'%s\' is not in the alphabet.", symbolize(c).c_str());
+		return symbId;
+	}
+	friend class DeterministicFiniteAutomaton;
+public:
+	// verify checks the checksum and then every entry of the tables, two passes over the file,
+	// without it only the header and the section sizes are checked and the contents are trusted, so opening touches one page
+	explicit DeterministicFiniteAutomatonView(const std::string &path, bool verify = true);
+	DeterministicFiniteAutomatonView(const DeterministicFiniteAutomatonView &) = delete;
+	DeterministicFiniteAutomatonView &operator = (const DeterministicFiniteAutomatonView &) = delete;
+	int size() const {
+		return head->states;
+	}
+	int alphabetSize() const {
+		return head->symbols;
+	}
+	bool sparse() const {
+		return head->flags & flagSparse;
+	}
+	int start() const {
+		return head->start;
+	}
+	// id of a symbol, -1 if it is not in the alphabet
+	int symbolId(int c) const {
+		unsigned k = (unsigned)c - (unsigned)head->lutLow;
+		if (k < (unsigned)head->lutSize)
+			return lookupData[k];
+		int lo = 0, hi = head->symbols;
+		while (lo < hi) {
+			int mid = (lo + hi) / 2;
+			if (sortedData[mid * 2] < c)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		return lo < head->symbols && sortedData[lo * 2] == c ? sortedData[lo * 2 + 1] : -1;
+	}
+	int symbol(int symbId) const {
+		if (symbId < 0 || symbId >= head->symbols)
+			RE("[Error] DFA::View::symbol : Invalid symbol id (%d) violates the range [0, %d].", symbId, head->symbols - 1);
+		return symbolData[symbId];
+	}
+	bool accept(int index) const {
+		if (index == -1)
+			return false;
+		if (index < 0 || index >= head->states)
+			RE("[Error] DFA::View::accept : Invalid state internal index (%d) violates the range [0, %d].", index, head->states - 1);
+		return acceptData[index >> 6] >> (index & 63) & 1u;
+	}
+	// label of an accept state, -1 for the other states
+	int label(int index) const {
+		if (!accept(index))
+			return -1;
+		return labelData ? labelData[index] : 0;
+	}
+	// state index after reading [first, last) from index, -1 once an empty transition is met
+	int run(int index, const char *first, const char *last) const {
+		if (index < -1 || index >= head->states)
+			RE("[Error] DFA::View::run : Invalid state internal index (%d) violates the range [0, %d].", index, head->states - 1);
+		if (sparse()) {
+			for (; first != last; ++first) {
+				int symbId = symbolIdChecked((int)*first);
+				if (index != -1)
+					index = sparseGet(index, symbId);
+			}
+			return index;
+		}
+		if (head->width == 1)
+			return runDense<uint8_t>(index, first, last);
+		if (head->width == 2)
+			return runDense<uint16_t>(index, first, last);
+		return runDense<uint32_t>(index, first, last);
+	}
+	int transition(int index, int symbol) const {
+		int symbId = symbolIdChecked(symbol);
+		if (index == -1)
+			return -1;
+		return transitionId(index, symbId);
+	}
+	bool match(const char *first, const char *last) const {
+		return accept(run(head->start, first, last));
+	}
+	bool match(const std::string &symbString) const {
+		return match(symbString.data(), symbString.data() + symbString.length());
+	}
+	std::string stateName(int index) const {
+		if (index < 0 || index >= head->states)
+			RE("[Error] DFA::View::stateName : Invalid state internal index (%d) violates the range [0, %d].", index, head->states - 1);
+		if (nameIndex && nameIndex[index + 1] != nameIndex[index])
+			return std::string(nameData + nameIndex[index], nameData + nameIndex[index + 1]);
+		return "q_" + std::to_string(index);
+	}
+	~DeterministicFiniteAutomatonView();
+private:
+	int transitionId(int index, int symbId) const {
+		if (index < 0 || index >= head->states)
+			RE("[Error] DFA::View::transition : Invalid state internal index (%d) violates the range [0, %d].", index, head->states - 1);
+		if (sparse())
+			return sparseGet(index, symbId);
+		return entry((size_t)index * head->columns + (columnData ? columnData[symbId] : symbId));
+	}
+	// k-th entry of the dense table, -1 for an empty transition
+	int entry(size_t k) const {
+		if (head->width == 1) {
+			uint8_t v = ((const uint8_t *)tableData)[k];
+			return v == 0xFFu ? -1 : (int)v;
+		}
+		if (head->width == 2) {
+			uint16_t v = ((const uint16_t *)tableData)[k];
+			return v == 0xFFFFu ? -1 : (int)v;
+		}
+		uint32_t v = ((const uint32_t *)tableData)[k];
+		return v == 0xFFFFFFFFu ? -1 : (int)v;
+	}
+};
+DeterministicFiniteAutomatonView::DeterministicFiniteAutomatonView(const std::string &path, bool verify) : base(nullptr), length(0), head(nullptr) {
+#if defined(__unix__) || defined(__APPLE__)
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd == -1)
+		RE("[Error] DFA::View : Cannot open file \'%s\'.", path.c_str());
+	struct stat st;
+	if (::fstat(fd, &st) == -1)
+		RE("[Error] DFA::View : Cannot stat file \'%s\'.", path.c_str());
+	length = (size_t)st.st_size;
+	if (length >= sizeof(Header)) {
+		void *addr = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (addr == MAP_FAILED)
+			RE("[Error] DFA::View : Cannot map file \'%s\'.", path.c_str());
+		base = (const char *)addr;
+	}
+	::close(fd);
+#else
+	std::ifstream in(path, std::ios::binary);
+	if (!in)
+		RE("[Error] DFA::View : Cannot open file \'%s\'.", path.c_str());
+	in.seekg(0, std::ios::end);
+	length = (size_t)in.tellg();
+	in.seekg(0, std::ios::beg);
+	buffer.resize((length + 7) / 8);
+	in.read((char *)buffer.data(), length);
+	base = (const char *)buffer.data();
+#endif
+	validate(path, verify);
+}
+DeterministicFiniteAutomatonView::~DeterministicFiniteAutomatonView() {
+#if defined(__unix__) || defined(__APPLE__)
+	if (base)
+		::munmap((void *)base, length);
+#endif
+}
+void DeterministicFiniteAutomatonView::validate(const std::string &path, bool verify) {
+	if (length < sizeof(Header))
+		RE("[Error] DFA::View : File \'%s\' is too short.", path.c_str());
+	head = (const Header *)base;
+	if (std::memcmp(head->magic, magicBytes(), 8) != 0)
+		RE("[Error] DFA::View : File \'%s\' is not an automaton image.", path.c_str());
+	if (head->byteOrder != 0x01020304u)
+		RE("[Error] DFA::View : File \'%s\' was written with another byte order.", path.c_str());
+	if (head->version != currentVersion)
+		RE("[Error] DFA::View : File \'%s\' has version %u, expected %u.", path.c_str(), head->version, currentVersion);
+	if (head->fileSize != length || length % 8 != 0)
+		RE("[Error] DFA::View : File \'%s\' is truncated.", path.c_str());
+	for (int sec = 0; sec < SectionCount; ++sec)
+		if (head->offset[sec] % 64 != 0 || head->offset[sec] > length || head->length[sec] > length - head->offset[sec])
+			RE("[Error] DFA::View : File \'%s\' has a malformed section table.", path.c_str());
+	int n = head->states, m = head->symbols;
+	bool sparse = head->flags & flagSparse;
+	int cols = sparse ? 0 : head->columns;
+	if (n <= 0 || m <= 0 || head->start < -1 || head->start >= n || head->lutSize < 0
+		|| (!sparse && (cols <= 0 || head->width != TransitionTable::widthFor(n)))
+		|| head->length[Symbols] != (uint64_t)m * 4 || head->length[SortedSymbols] != (uint64_t)m * 8
+		|| head->length[Lookup] != (uint64_t)head->lutSize * 4 || head->length[Accept] != (uint64_t)(n + 63) / 64 * 8
+		|| (head->length[Columns] != 0 && head->length[Columns] != (uint64_t)m * 4)
+		|| head->length[Table] != (sparse ? (uint64_t)(n + 1) * 8 : (uint64_t)n * cols * head->width)
+		|| (sparse ? head->length[Ranges] % 12 != 0 : head->length[Ranges] != 0)
+		|| ((head->flags & flagNames) ? head->length[NameIndex] != (uint64_t)(n + 1) * 8 : head->length[NameIndex] != 0)
+		|| (head->length[Labels] != 0 && head->length[Labels] != (uint64_t)n * 4))
+		RE("[Error] DFA::View : File \'%s\' has inconsistent sizes.", path.c_str());
+	if (verify && checksum(base, length) != head->checksum)
+		RE("[Error] DFA::View : Checksum mismatch in file \'%s\'.", path.c_str());
+	symbolData = (const int32_t *)section(Symbols);
+	sortedData = (const int32_t *)section(SortedSymbols);
+	lookupData = (const int32_t *)section(Lookup);
+	acceptData = (const uint64_t *)section(Accept);
+	columnData = (const int32_t *)section(Columns);
+	tableData = section(Table);
+	rowData = (const uint64_t *)tableData;
+	rangeData = (const int32_t *)section(Ranges);
+	nameIndex = (const uint64_t *)section(NameIndex);
+	nameData = section(NameData);
+	labelData = (const int32_t *)section(Labels);
+	// range count bounded before multiplying so that a crafted last offset cannot wrap around
+	if (sparse && (rowData[n] > head->length[Ranges] / 12 || rowData[n] * 12 != head->length[Ranges]))
+		RE("[Error] DFA::View : File \'%s\' has inconsistent sizes.", path.c_str());
+	if (!sparse && !columnData && cols != m)
+		RE("[Error] DFA::View : File \'%s\' has a malformed column map.", path.c_str());
+	if (nameIndex && (nameIndex[0] != 0 || nameIndex[n] != head->length[NameData]))
+		RE("[Error] DFA::View : File \'%s\' has inconsistent sizes.", path.c_str());
+	// the contents are only scanned for a verified open, an unverified one touches no more than the header
+	if (verify)
+		validateContents(path);
+}
+void DeterministicFiniteAutomatonView::validateContents(const std::string &path) const {
+	int n = head->states, m = head->symbols, cols = head->columns;
+	for (int j = 0; j < m; ++j)
+		if (sortedData[j * 2 + 1] < 0 || sortedData[j * 2 + 1] >= m || (j > 0 && sortedData[j * 2] <= sortedData[j * 2 - 2]))
+			RE("[Error] DFA::View : File \'%s\' has a malformed symbol table.", path.c_str());
+	for (int k = 0; k < head->lutSize; ++k)
+		if (lookupData[k] < -1 || lookupData[k] >= m)
+			RE("[Error] DFA::View : File \'%s\' has a malformed symbol table.", path.c_str());
+	if (sparse()) {
+		uint64_t total = rowData[n];
+		if (rowData[0] != 0)
+			RE("[Error] DFA::View : File \'%s\' has malformed ranges.", path.c_str());
+		for (int u = 0; u < n; ++u) {
+			if (rowData[u] > rowData[u + 1] || rowData[u + 1] > total)
+				RE("[Error] DFA::View : File \'%s\' has malformed ranges.", path.c_str());
+			for (uint64_t i = rowData[u]; i < rowData[u + 1]; ++i) {
+				const int32_t *r = rangeData + i * 3;
+				if (r[0] < 0 || r[0] > r[1] || r[1] >= m || r[2] < 0 || r[2] >= n || (i > rowData[u] && r[0] <= r[-2]))
+					RE("[Error] DFA::View : File \'%s\' has malformed ranges.", path.c_str());
+			}
+		}
+	}
+	else {
+		for (int j = 0; columnData && j < m; ++j)
+			if (columnData[j] < 0 || columnData[j] >= cols)
+				RE("[Error] DFA::View : File \'%s\' has a malformed column map.", path.c_str());
+		for (size_t k = 0; k < (size_t)n * cols; ++k)
+			if (entry(k) >= n)
+				RE("[Error] DFA::View : File \'%s\' has a malformed transition table.", path.c_str());
+	}
+	for (int u = 0; nameIndex && u < n; ++u)
+		if (nameIndex[u] > nameIndex[u + 1])
+			RE("[Error] DFA::View : File \'%s\' has inconsistent sizes.", path.c_str());
+	for (int u = 0; labelData && u < n; ++u)
+		if (labelData[u] < 0)
+			RE("[Error] DFA::View : File \'%s\' has malformed labels.", path.c_str());
+}
+void DeterministicFiniteAutomaton::save(const std::string &path, bool withNames) const {
+	typedef DeterministicFiniteAutomatonView View;
+	if (n == 0)
+		RE("[Error] DFA::save : Empty automaton.");
+	if (sig.empty())
+		RE("[Error] DFA::save : Empty alphabet.");
+	int m = sig.size();
+	View::Header head;
+	std::memset(&head, 0, sizeof(head));
+	std::memcpy(head.magic, View::magicBytes(), 8);
+	head.version = View::currentVersion;
+	head.byteOrder = 0x01020304u;
+	head.states = n, head.symbols = m, head.start = startStateIndex;
+	bool names = withNames && mergedNames;
+	for (int u = 0; withNames && !names && u < n; ++u)
+		names = !stateNames[u].empty();
+	head.flags = (isSparse ? View::flagSparse : 0u) | (names ? View::flagNames : 0u);
+	head.columns = isSparse ? 0 : transitions.cols();
+	head.width = isSparse ? 0 : transitions.width();
+	head.lutLow = sig.compiled() ? sig.tableLow() : 0;
+	head.lutSize = sig.compiled() ? sig.tableSize() : 0;
+	// section contents
+	std::vector<int32_t> symbols(m), sorted(2 * (size_t)m), ranges;
+	std::vector<std::pair<int, int>> bySymbol(m);
+	for (int j = 0; j < m; ++j)
+		symbols[j] = sig.i2c(j), bySymbol[j] = std::make_pair(symbols[j], j);
+	std::sort(bySymbol.begin(), bySymbol.end());
+	for (int j = 0; j < m; ++j)
+		sorted[2 * j] = bySymbol[j].first, sorted[2 * j + 1] = bySymbol[j].second;
+	std::vector<uint64_t> accept((n + 63) / 64, 0), rows, nameIndex;
+	for (int u = 0; u < n; ++u)
+		if (acceptStates[u])
+			accept[u >> 6] |= 1ull << (u & 63);
+	std::string nameData;
+	if (names) {
+		nameIndex.push_back(0);
+		for (int u = 0; u < n; ++u)
+			nameData += explicitName(u), nameIndex.push_back(nameData.size());
+	}
+	const void *table = nullptr;
+	size_t tableBytes = transitions.bytes();
+	if (isSparse) {
+		rows.push_back(0);
+		for (int u = 0; u < n; ++u) {
+			for (const SparseRange &r : sparseRows[u])
+				ranges.push_back(r.lo), ranges.push_back(r.hi), ranges.push_back(r.to);
+			rows.push_back(ranges.size() / 3);
+		}
+		table = rows.data(), tableBytes = rows.size() * 8;
+	}
+	else if (transitions.width() == 1)
+		table = transitions.data8();
+	else if (transitions.width() == 2)
+		table = transitions.data16();
+	else
+		table = transitions.data32();
+	const void *data[View::SectionCount] = {symbols.data(), sorted.data(), sig.table(), accept.data(), symbolClass.data(),
+		table, ranges.data(), nameIndex.data(), nameData.data(), acceptLabels.data()};
+	size_t bytes[View::SectionCount] = {symbols.size() * 4, sorted.size() * 4, (size_t)head.lutSize * 4, accept.size() * 8,
+		symbolClass.size() * 4, tableBytes, ranges.size() * 4, nameIndex.size() * 8, nameData.size(), acceptLabels.size() * 4};
+	// layout with every section aligned to 64 bytes, the file length rounded up as well
+	uint64_t offset = (sizeof(View::Header) + 63) / 64 * 64;
+	for (int sec = 0; sec < View::SectionCount; ++sec) {
+		head.offset[sec] = bytes[sec] ? offset : 0;
+		head.length[sec] = bytes[sec];
+		offset += (bytes[sec] + 63) / 64 * 64;
+	}
+	head.fileSize = offset;
+	std::vector<char> image(offset, 0);
+	for (int sec = 0; sec < View::SectionCount; ++sec)
+		if (bytes[sec])
+			std::memcpy(image.data() + head.offset[sec], data[sec], bytes[sec]);
+	std::memcpy(image.data(), &head, sizeof(head));
+	head.checksum = View::checksum(image.data(), image.size());
+	std::memcpy(image.data(), &head, sizeof(head));
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out)
+		RE("[Error] DFA::save : Cannot open file \'%s\'.", path.c_str());
+	out.write(image.data(), (std::streamsize)image.size());
+	if (!out)
+		RE("[Error] DFA::save : Cannot write file \'%s\'.", path.c_str());
+}
+DeterministicFiniteAutomaton DeterministicFiniteAutomaton::load(const std::string &path) {
+	DeterministicFiniteAutomatonView view(path, true); // the full check, load() copies the tables unchecked
+	const DeterministicFiniteAutomatonView::Header &head = *view.head;
+	int m = head.symbols, siz = head.states;
+	std::shared_ptr<const std::vector<int>> symbols = std::make_shared<const std::vector<int>>(view.symbolData, view.symbolData + m);
+	std::shared_ptr<const std::vector<int>> sorted = std::make_shared<const std::vector<int>>(view.sortedData, view.sortedData + 2 * m);
+	Alphabet alph(m, [symbols](int id) { return (*symbols)[id]; }, [sorted](int c) {
+		int lo = 0, hi = (int)sorted->size() / 2;
+		while (lo < hi) {
+			int mid = (lo + hi) / 2;
+			if ((*sorted)[mid * 2] < c)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		return lo < (int)sorted->size() / 2 && (*sorted)[lo * 2] == c ? (*sorted)[lo * 2 + 1] : -1;
+	});
+	DeterministicFiniteAutomaton ret(alph);
+	ret.isSparse = true; // no dense table is allocated before its final width is known
+	ret.setSize(siz);
+	if (view.sparse()) {
+		for (int u = 0; u < siz; ++u)
+			for (uint64_t i = view.rowData[u]; i < view.rowData[u + 1]; ++i) {
+				const int32_t *r = view.rangeData + i * 3;
+				ret.sparseRows[u].push_back({r[0], r[1], r[2]});
+			}
+	}
+	else {
+		int cols = head.columns;
+		ret.isSparse = false;
+		std::vector<std::vector<SparseRange>>().swap(ret.sparseRows);
+		if (view.columnData)
+			ret.symbolClass.assign(view.columnData, view.columnData + m);
+		ret.transitions.reset(siz, cols);
+		for (int u = 0; u < siz; ++u)
+			for (int c = 0; c < cols; ++c)
+				ret.transitions.set(u, c, view.entry((size_t)u * cols + c));
+	}
+	ret.countEmptyTransitions = ret.countEmptyEntries();
+	ret.isComplete = ret.countEmptyTransitions == 0;
+	if (view.labelData)
+		ret.acceptLabels.assign(view.labelData, view.labelData + siz);
+	for (int u = 0; u < siz; ++u) {
+		ret.acceptStates[u] = (unsigned char)view.accept(u);
+		if (view.nameIndex)
+			ret.stateNames[u].assign(view.nameData + view.nameIndex[u], view.nameData + view.nameIndex[u + 1]);
+	}
+	ret.startStateIndex = head.start;
+	return ret;
+}
 
 #undef RE
 #undef WARN
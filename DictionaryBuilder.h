@@ -0,0 +1,255 @@
+// PinkRabbit
+// 2026-10-16
+// Minimal acyclic automata built word by word with a register of states (Daciuk, Mihov, Watson and Watson)
+
+#ifndef DICTIONARYBUILDER_H__PINKRABBIT
+#define DICTIONARYBUILDER_H__PINKRABBIT
+
+#include "DFA.h"
+
+#define RE(...) void(), std::fprintf(stderr, __VA_ARGS__), std::exit(23), void()
+
+// the automaton of a finite set of words, minimal after every word, without a sink state or full rows:
+// two states are equivalent when they have the same finality and the same transitions, so the register,
+// a hash of (finality, transitions) over the finished states, finds the equivalent of a new state at once
+// while the words come in increasing order of symbol ids, only the path of the last word is left out of the register
+// and it is registered from its end up to where the next word leaves it (the sorted algorithm),
+// the first word out of order, or toDFA, registers that path and every later word takes the general way:
+// the path of the word is cloned from its first state with several incoming transitions, its new suffix is added,
+// and the path is registered again from the end up to the start state
+class DictionaryBuilder {
+private:
+	Alphabet sig;
+	std::vector<std::vector<std::pair<int, int>>> out; // (symbol id, target) of every state sorted by symbol id
+	std::vector<unsigned char> finalStates;
+	std::vector<int> inDegree;
+	std::vector<int> freeStates; // removed states to be used again
+	std::unordered_multimap<uint64_t, int> registry;
+	std::vector<uint64_t> registeredHash;
+	std::vector<unsigned char> registered;
+	size_t wordCount;
+	// the sorted algorithm, the last word and its path from the start state 0
+	bool ordered;
+	std::vector<int> lastWord, path;
+	std::vector<int> word;
+	int newState() {
+		int u;
+		if (!freeStates.empty()) {
+			u = freeStates.back();
+			freeStates.pop_back();
+			return u;
+		}
+		u = (int)out.size();
+		out.emplace_back();
+		finalStates.push_back(0u), inDegree.push_back(0), registeredHash.push_back(0ull), registered.push_back(0u);
+		return u;
+	}
+	void removeState(int u) {
+		for (const std::pair<int, int> &e : out[u])
+			--inDegree[e.second];
+		out[u].clear();
+		finalStates[u] = 0u;
+		inDegree[u] = 0;
+		freeStates.push_back(u);
+	}
+	int clone(int u) {
+		int v = newState();
+		out[v] = out[u];
+		finalStates[v] = finalStates[u];
+		for (const std::pair<int, int> &e : out[v])
+			++inDegree[e.second];
+		return v;
+	}
+	int target(int u, int symbId) const {
+		std::vector<std::pair<int, int>>::const_iterator it = std::lower_bound(out[u].begin(), out[u].end(), std::make_pair(symbId, -1));
+		return it != out[u].end() && it->first == symbId ? it->second : -1;
+	}
+	void setTarget(int u, int symbId, int v) {
+		std::vector<std::pair<int, int>>::iterator it = std::lower_bound(out[u].begin(), out[u].end(), std::make_pair(symbId, -1));
+		if (it != out[u].end() && it->first == symbId) {
+			--inDegree[it->second];
+			it->second = v;
+		}
+		else
+			out[u].insert(it, std::make_pair(symbId, v));
+		++inDegree[v];
+	}
+	uint64_t hashOf(int u) const {
+		uint64_t h = finalStates[u] ? 0x9E3779B97F4A7C15ull : 1469598103934665603ull;
+		for (const std::pair<int, int> &e : out[u]) {
+			h = (h ^ (uint64_t)(unsigned)e.first) * 1099511628211ull;
+			h = (h ^ (uint64_t)(unsigned)e.second) * 1099511628211ull;
+		}
+		return h ^ (h >> 29);
+	}
+	// the registered state equivalent to u, or -1 after registering u itself
+	int replaceOrRegister(int u) {
+		uint64_t h = hashOf(u);
+		auto range = registry.equal_range(h);
+		for (auto it = range.first; it != range.second; ++it)
+			if (finalStates[it->second] == finalStates[u] && out[it->second] == out[u])
+				return it->second;
+		registry.emplace(h, u);
+		registeredHash[u] = h, registered[u] = 1u;
+		return -1;
+	}
+	void unregister(int u) {
+		if (!registered[u])
+			return ;
+		auto range = registry.equal_range(registeredHash[u]);
+		for (auto it = range.first; it != range.second; ++it)
+			if (it->second == u) {
+				registry.erase(it);
+				break;
+			}
+		registered[u] = 0u;
+	}
+	// registers the states of the path deeper than depth, from the end upwards, on the symbols of along
+	void registerPath(std::vector<int> &states, const std::vector<int> &along, size_t depth) {
+		for (size_t i = states.size() - 1; i > depth; --i) {
+			int r = replaceOrRegister(states[i]);
+			if (r == -1)
+				continue;
+			setTarget(states[i - 1], along[i - 1], r);
+			removeState(states[i]);
+			states[i] = r;
+		}
+	}
+	void addOrdered() {
+		size_t p = 0;
+		while (p < word.size() && p < lastWord.size() && word[p] == lastWord[p])
+			++p;
+		if (p == word.size() && p == lastWord.size() && finalStates[path[p]])
+			return ;
+		registerPath(path, lastWord, p);
+		path.resize(p + 1);
+		for (size_t i = p; i < word.size(); ++i) {
+			int v = newState();
+			setTarget(path.back(), word[i], v);
+			path.push_back(v);
+		}
+		finalStates[path.back()] = 1u;
+		lastWord.swap(word);
+		++wordCount;
+	}
+	void addUnordered() {
+		std::vector<int> &states = path;
+		states.assign(1, 0);
+		size_t k = 0;
+		for (int v; k < word.size() && (v = target(states[k], word[k])) != -1; ++k)
+			states.push_back(v);
+		if (k == word.size() && finalStates[states[k]])
+			return ;
+		// states before the first one with several incoming transitions change in place, the others are cloned
+		size_t first = 1;
+		while (first <= k && inDegree[states[first]] == 1)
+			unregister(states[first++]);
+		for (size_t i = first; i <= k; ++i) {
+			int v = clone(states[i]);
+			setTarget(states[i - 1], word[i - 1], v);
+			states[i] = v;
+		}
+		for (size_t i = k; i < word.size(); ++i) {
+			int v = newState();
+			setTarget(states.back(), word[i], v);
+			states.push_back(v);
+		}
+		finalStates[states.back()] = 1u;
+		registerPath(states, word, 0);
+		++wordCount;
+	}
+	void add() {
+		if (ordered && (wordCount == 0 || !std::lexicographical_compare(word.begin(), word.end(), lastWord.begin(), lastWord.end())))
+			return addOrdered();
+		if (ordered) {
+			registerPath(path, lastWord, 0);
+			ordered = false;
+		}
+		addUnordered();
+	}
+public:
+	DictionaryBuilder(const Alphabet &alph) : sig(alph), wordCount(0), ordered(true) {
+		if (alph.empty())
+			RE("[Error] DictionaryBuilder : Provided alphabet is empty.");
+		path.assign(1, newState());
+	}
+	DictionaryBuilder(const DictionaryBuilder &) = default;
+	DictionaryBuilder(DictionaryBuilder &&) = default;
+	DictionaryBuilder &operator = (const DictionaryBuilder &) = default;
+	DictionaryBuilder &operator = (DictionaryBuilder &&) = default;
+	const Alphabet &alphabet() const {
+		return sig;
+	}
+	// a word added again is ignored
+	void addWord(const std::string &symbString) {
+		word.resize(symbString.length());
+		for (size_t i = 0; i < symbString.length(); ++i)
+			word[i] = sig.c2i((int)symbString[i]);
+		add();
+	}
+	void addWord(const std::vector<int> &symbols) {
+		word.resize(symbols.size());
+		for (size_t i = 0; i < symbols.size(); ++i)
+			word[i] = sig.c2i(symbols[i]);
+		add();
+	}
+	// number of distinct words
+	size_t words() const {
+		return wordCount;
+	}
+	// number of states, the start state included
+	int size() const {
+		return (int)(out.size() - freeStates.size());
+	}
+	// whether the words came in increasing order so far, so that the sorted algorithm is used
+	bool sorted() const {
+		return ordered;
+	}
+	// the minimal automaton of the words, partial, states numbered in breadth first order from the start state 0,
+	// with sparse rows or compressed alphabet columns, whichever is smaller
+	DeterministicFiniteAutomaton toDFA();
+	~DictionaryBuilder() = default;
+};
+
+DeterministicFiniteAutomaton DictionaryBuilder::toDFA() {
+	if (ordered) {
+		registerPath(path, lastWord, 0);
+		ordered = false;
+	}
+	std::vector<int> id(out.size(), -1), que(1, 0), edges;
+	std::vector<unsigned char> used(sig.size(), 0u);
+	size_t ranges = 0;
+	id[0] = 0;
+	for (size_t h = 0; h < que.size(); ++h)
+		for (size_t i = 0; i < out[que[h]].size(); ++i) {
+			const std::pair<int, int> &e = out[que[h]][i];
+			if (id[e.second] == -1) {
+				id[e.second] = (int)que.size();
+				que.push_back(e.second);
+			}
+			edges.push_back((int)h), edges.push_back(sig.i2c(e.first)), edges.push_back(id[e.second]);
+			used[e.first] = 1u;
+			// symbols next to each other with the same target share a range of the row
+			ranges += i == 0 || out[que[h]][i - 1].first + 1 != e.first || out[que[h]][i - 1].second != e.second;
+		}
+	int cnt = (int)que.size();
+	DeterministicFiniteAutomaton ret(sig);
+	ret.useSparseTransitions();
+	ret.setSize(cnt);
+	ret.setTransitions(edges);
+	for (int s = 0; s < cnt; ++s)
+		if (finalStates[que[s]])
+			ret.flipStateAcceptance(ret[s]);
+	ret.setStartState(ret[0]);
+	// a column for every symbol on some transition and one for the others, compressAlphabet may merge some more
+	int classes = (int)std::count(used.begin(), used.end(), 1u);
+	classes += classes < sig.size();
+	std::pair<size_t, size_t> bytes = DeterministicFiniteAutomaton::layoutBytes(cnt, sig.size(), classes, ranges);
+	if (bytes.first < bytes.second)
+		ret.compressAlphabet();
+	return ret;
+}
+
+#undef RE
+
+#endif
@@ -0,0 +1,482 @@
+// PinkRabbit
+// 2026-10-16
+// Nondeterministic finite automata with epsilon transitions, bitset simulation and subset construction
+
+#ifndef NFA_H__PINKRABBIT
+#define NFA_H__PINKRABBIT
+
+#include "DFA.h"
+
+#define RE(...) void(), std::fprintf(stderr, __VA_ARGS__), std::exit(23), void()
+
+// states are plain indices from 0, several of them may be start states,
+// the automaton can be simulated directly by simulator() or determinized by toDFA()
+class NondeterministicFiniteAutomaton {
+private:
+	int n;
+	Alphabet sig;
+	std::vector<std::vector<std::pair<int, int>>> edges; // (symbol id, target) of every state
+	std::vector<std::vector<int>> epsilonEdges;
+	std::vector<int> startStates;
+	std::vector<unsigned char> acceptStates;
+	void checkState(int u, const char *func) const {
+		if (u < 0 || u >= n)
+			RE("[Error] NFA::%s : Invalid state index (%d) violates the range [0, %d].", func, u, n - 1);
+	}
+public:
+	NondeterministicFiniteAutomaton() : n(0) {}
+	NondeterministicFiniteAutomaton(const Alphabet &alph) : n(0), sig(alph) {}
+	NondeterministicFiniteAutomaton(const NondeterministicFiniteAutomaton &) = default;
+	NondeterministicFiniteAutomaton(NondeterministicFiniteAutomaton &&) = default;
+	NondeterministicFiniteAutomaton &operator = (const NondeterministicFiniteAutomaton &) = default;
+	NondeterministicFiniteAutomaton &operator = (NondeterministicFiniteAutomaton &&) = default;
+	bool empty() const {
+		return n == 0;
+	}
+	int size() const {
+		return n;
+	}
+	const Alphabet &alphabet() const {
+		return sig;
+	}
+	bool alphabetEmpty() const {
+		return sig.empty();
+	}
+	int alphabetSize() const {
+		return sig.size();
+	}
+	void clear() {
+		n = 0;
+		sig.clear();
+		edges.clear();
+		epsilonEdges.clear();
+		startStates.clear();
+		acceptStates.clear();
+	}
+	void setAlphabet(const Alphabet &alph) {
+		if (alph.empty())
+			RE("[Error] NFA::setAlphabet : Provided alphabet is empty.");
+		if (!sig.empty())
+			RE("[Error] NFA::setAlphabet : Alphabet already exists.");
+		sig = alph;
+	}
+	void setSize(int siz) {
+		if (n != 0)
+			RE("[Error] NFA::setSize : Original NFA is not empty.");
+		if (siz <= 0)
+			RE("[Error] NFA::setSize : Provided size (%d) is a non-positive integer.", siz);
+		n = siz;
+		edges.resize(n);
+		epsilonEdges.resize(n);
+		acceptStates.resize(n, 0u);
+	}
+	// a new state without transitions, returns its index
+	int addState(bool accept = false) {
+		edges.emplace_back();
+		epsilonEdges.emplace_back();
+		acceptStates.push_back((unsigned char)accept);
+		return n++;
+	}
+	void addTransition(int from, int symbol, int to) {
+		if (sig.empty())
+			RE("[Error] NFA::addTransition : Empty alphabet.");
+		checkState(from, "addTransition");
+		checkState(to, "addTransition");
+		edges[from].emplace_back(sig.c2i(symbol), to);
+	}
+	void addEpsilonTransition(int from, int to) {
+		checkState(from, "addEpsilonTransition");
+		checkState(to, "addEpsilonTransition");
+		epsilonEdges[from].push_back(to);
+	}
+	void addStartState(int u) {
+		checkState(u, "addStartState");
+		startStates.push_back(u);
+	}
+	const std::vector<int> &getStartStates() const {
+		return startStates;
+	}
+	void setAcceptState(int u, bool value = true) {
+		checkState(u, "setAcceptState");
+		acceptStates[u] = (unsigned char)value;
+	}
+	bool isAcceptState(int u) const {
+		checkState(u, "isAcceptState");
+		return (bool)acceptStates[u];
+	}
+	// number of transitions on symbols and of epsilon transitions, duplicates included
+	size_t transitionCount() const {
+		size_t ret = 0;
+		for (int u = 0; u < n; ++u)
+			ret += edges[u].size() + epsilonEdges[u].size();
+		return ret;
+	}
+	// direct simulation over sets of states kept as bitsets, built once by simulator() and independent of the automaton afterwards,
+	// symbols with the same targets from every state share a column, every set is closed under epsilon transitions
+	// with at most 64 states a set is a single word and the transitions are precomputed words (Word),
+	// and when every state is entered on one set of columns only, as the positions of a Glushkov automaton are,
+	// a step is follow(D) & B[c] with follow(D) read from byte tables (Glushkov), or D << 1 for a chain (ShiftAnd)
+	class Simulator {
+		friend class NondeterministicFiniteAutomaton;
+	public:
+		enum Mode {
+			Bitset, Word, Glushkov, ShiftAnd
+		};
+	private:
+		Alphabet sig;
+		int n, cols, words;
+		Mode how;
+		std::vector<int> classOf; // column of every symbol id
+		std::vector<int> edgeBegin, edgeClass, edgeTo; // edges of every state sorted by column
+		std::vector<int> epsBegin, epsTo;
+		std::vector<uint64_t> startSet, acceptSet;
+		// at most 64 states
+		std::vector<uint64_t> wordTrans; // targets of u on column c at u * cols + c
+		std::vector<uint64_t> followTable; // follow sets of the states in every byte of a set, 256 entries per byte
+		std::vector<uint64_t> columnMask; // states entered on every column
+		int chunks;
+		Simulator(const NondeterministicFiniteAutomaton &nfa);
+		static int lowestBit(uint64_t x) {
+#if defined(__GNUC__)
+			return __builtin_ctzll(x);
+#else
+			int ret = 0;
+			while (!(x & 1u))
+				x >>= 1, ++ret;
+			return ret;
+#endif
+		}
+		void add(uint64_t *set, int v, std::vector<int> &stack) const {
+			uint64_t bit = 1ull << (v & 63);
+			if (set[v >> 6] & bit)
+				return ;
+			set[v >> 6] |= bit;
+			if (epsBegin[v] != epsBegin[v + 1])
+				stack.push_back(v);
+		}
+		void close(uint64_t *set, std::vector<int> &stack) const {
+			while (!stack.empty()) {
+				int v = stack.back();
+				stack.pop_back();
+				for (int i = epsBegin[v]; i < epsBegin[v + 1]; ++i)
+					add(set, epsTo[i], stack);
+			}
+		}
+		// the closed set of targets of the states in from on column c
+		void step(const uint64_t *from, int c, uint64_t *to, std::vector<int> &stack) const {
+			std::fill(to, to + words, 0ull);
+			for (int w = 0; w < words; ++w)
+				for (uint64_t x = from[w]; x; x &= x - 1) {
+					int u = w * 64 + lowestBit(x);
+					int i = (int)(std::lower_bound(edgeClass.begin() + edgeBegin[u], edgeClass.begin() + edgeBegin[u + 1], c) - edgeClass.begin());
+					for (; i < edgeBegin[u + 1] && edgeClass[i] == c; ++i)
+						add(to, edgeTo[i], stack);
+				}
+			close(to, stack);
+		}
+		uint64_t follow(uint64_t d) const {
+			uint64_t ret = 0;
+			for (int i = 0; i < chunks; ++i)
+				ret |= followTable[(size_t)i * 256 + (d >> (i * 8) & 0xFF)];
+			return ret;
+		}
+		int column(int c) const {
+			int symbId = sig.lookup(c);
+			if (symbId < 0 || symbId >= sig.size())
+				sig.c2i(c);
+			return classOf[symbId];
+		}
+		// every symbol is still checked against the alphabet once the set is empty
+		template <typename C>
+		bool acceptsWord(const C *first, const C *last) const {
+			uint64_t d = startSet[0];
+			if (how == ShiftAnd)
+				for (; first != last && d; ++first)
+					d = (d << 1) & columnMask[column((int)*first)];
+			else if (how == Glushkov)
+				for (; first != last && d; ++first)
+					d = follow(d) & columnMask[column((int)*first)];
+			else
+				for (; first != last && d; ++first) {
+					int c = column((int)*first);
+					uint64_t next = 0;
+					for (uint64_t x = d; x; x &= x - 1)
+						next |= wordTrans[(size_t)lowestBit(x) * cols + c];
+					d = next;
+				}
+			for (; first != last; ++first)
+				column((int)*first);
+			return (d & acceptSet[0]) != 0;
+		}
+		template <typename C>
+		bool acceptsBitset(const C *first, const C *last) const {
+			std::vector<uint64_t> cur(startSet), next(words);
+			std::vector<int> stack;
+			bool alive = true;
+			for (; first != last && alive; ++first) {
+				step(cur.data(), column((int)*first), next.data(), stack);
+				cur.swap(next);
+				alive = false;
+				for (int w = 0; w < words && !alive; ++w)
+					alive = cur[w] != 0;
+			}
+			for (; first != last; ++first)
+				column((int)*first);
+			for (int w = 0; w < words; ++w)
+				if (cur[w] & acceptSet[w])
+					return true;
+			return false;
+		}
+	public:
+		Simulator(const Simulator &) = default;
+		Simulator(Simulator &&) = default;
+		Simulator &operator = (const Simulator &) = default;
+		Simulator &operator = (Simulator &&) = default;
+		int size() const {
+			return n;
+		}
+		// number of symbol columns
+		int columns() const {
+			return cols;
+		}
+		Mode mode() const {
+			return how;
+		}
+		// whether the automaton accepts [first, last) from its start states
+		template <typename C>
+		bool accepts(const C *first, const C *last) const {
+			return how == Bitset ? acceptsBitset(first, last) : acceptsWord(first, last);
+		}
+		bool accepts(const std::string &symbString) const {
+			return accepts(symbString.data(), symbString.data() + symbString.length());
+		}
+		bool accepts(const std::vector<int> &symbols) const {
+			return accepts(symbols.data(), symbols.data() + symbols.size());
+		}
+		~Simulator() = default;
+	};
+	Simulator simulator() const {
+		return Simulator(*this);
+	}
+	// subset construction from the closed set of start states, only subsets reachable from it become states,
+	// a subset is keyed by the hash of its bitset, the empty subset is left out so the result may be partial,
+	// fails with more than stateLimit states
+	DeterministicFiniteAutomaton toDFA(int stateLimit = 1 << 22) const;
+	~NondeterministicFiniteAutomaton() = default;
+};
+
+NondeterministicFiniteAutomaton::Simulator::Simulator(const NondeterministicFiniteAutomaton &nfa)
+	: sig(nfa.sig), n(nfa.n), cols(0), words((nfa.n + 63) / 64), how(Bitset), chunks(0) {
+	if (nfa.empty())
+		RE("[Error] NFA::simulator : Empty automaton.");
+	if (nfa.alphabetEmpty())
+		RE("[Error] NFA::simulator : Empty alphabet.");
+	int m = sig.size();
+	// symbols are grouped by their sorted lists of (source, target) edges
+	std::vector<std::vector<std::pair<int, int>>> rows(n);
+	std::vector<int> symbolBegin(m + 1, 0);
+	for (int u = 0; u < n; ++u) {
+		rows[u] = nfa.edges[u];
+		std::sort(rows[u].begin(), rows[u].end());
+		rows[u].erase(std::unique(rows[u].begin(), rows[u].end()), rows[u].end());
+		for (const std::pair<int, int> &e : rows[u])
+			++symbolBegin[e.first + 1];
+	}
+	for (int j = 0; j < m; ++j)
+		symbolBegin[j + 1] += symbolBegin[j];
+	std::vector<std::pair<int, int>> bySymbol(symbolBegin[m]);
+	{
+		std::vector<int> pos(symbolBegin.begin(), symbolBegin.end() - 1);
+		for (int u = 0; u < n; ++u)
+			for (const std::pair<int, int> &e : rows[u])
+				bySymbol[pos[e.first]++] = std::make_pair(u, e.second);
+	}
+	std::unordered_multimap<uint64_t, int> firstOfHash;
+	classOf.assign(m, -1);
+	for (int j = 0; j < m; ++j) {
+		uint64_t h = (uint64_t)(symbolBegin[j + 1] - symbolBegin[j]);
+		for (int i = symbolBegin[j]; i < symbolBegin[j + 1]; ++i)
+			h = ((h ^ (uint64_t)bySymbol[i].first) * 0x100000001B3ull ^ (uint64_t)bySymbol[i].second) * 0x100000001B3ull;
+		auto range = firstOfHash.equal_range(h);
+		for (auto it = range.first; it != range.second && classOf[j] == -1; ++it) {
+			int r = it->second;
+			if (std::equal(bySymbol.begin() + symbolBegin[j], bySymbol.begin() + symbolBegin[j + 1], bySymbol.begin() + symbolBegin[r])
+				&& symbolBegin[j + 1] - symbolBegin[j] == symbolBegin[r + 1] - symbolBegin[r])
+				classOf[j] = classOf[r];
+		}
+		if (classOf[j] == -1) {
+			classOf[j] = cols++;
+			firstOfHash.emplace(h, j);
+		}
+	}
+	// edges by column
+	edgeBegin.assign(n + 1, 0);
+	std::vector<std::pair<int, int>> row;
+	for (int u = 0; u < n; ++u) {
+		row.clear();
+		for (const std::pair<int, int> &e : rows[u])
+			row.emplace_back(classOf[e.first], e.second);
+		std::sort(row.begin(), row.end());
+		row.erase(std::unique(row.begin(), row.end()), row.end());
+		for (const std::pair<int, int> &e : row)
+			edgeClass.push_back(e.first), edgeTo.push_back(e.second);
+		edgeBegin[u + 1] = (int)edgeTo.size();
+	}
+	epsBegin.assign(n + 1, 0);
+	for (int u = 0; u < n; ++u) {
+		epsTo.insert(epsTo.end(), nfa.epsilonEdges[u].begin(), nfa.epsilonEdges[u].end());
+		epsBegin[u + 1] = (int)epsTo.size();
+	}
+	std::vector<int> stack;
+	startSet.assign(words, 0ull);
+	for (int s : nfa.startStates)
+		add(startSet.data(), s, stack);
+	close(startSet.data(), stack);
+	acceptSet.assign(words, 0ull);
+	for (int u = 0; u < n; ++u)
+		if (nfa.acceptStates[u])
+			acceptSet[u >> 6] |= 1ull << (u & 63);
+	if (n > 64)
+		return ;
+	how = Word;
+	wordTrans.assign((size_t)n * cols, 0ull);
+	uint64_t from = 0, to = 0;
+	for (int u = 0; u < n; ++u) {
+		from = 1ull << u;
+		for (int c = 0; c < cols; ++c) {
+			step(&from, c, &to, stack);
+			wordTrans[(size_t)u * cols + c] = to;
+		}
+	}
+	// every state is entered on the same columns from wherever it is entered
+	std::vector<uint64_t> followOf(n, 0ull);
+	columnMask.assign(cols, 0ull);
+	for (int u = 0; u < n; ++u)
+		for (int c = 0; c < cols; ++c) {
+			followOf[u] |= wordTrans[(size_t)u * cols + c];
+			columnMask[c] |= wordTrans[(size_t)u * cols + c];
+		}
+	for (int u = 0; u < n; ++u)
+		for (int c = 0; c < cols; ++c)
+			if (wordTrans[(size_t)u * cols + c] != (followOf[u] & columnMask[c]))
+				return ;
+	bool chain = true;
+	for (int u = 0; u < n && chain; ++u)
+		chain = followOf[u] == (u + 1 < n ? 1ull << (u + 1) : 0ull);
+	if (chain) {
+		how = ShiftAnd;
+		std::vector<uint64_t>().swap(wordTrans);
+		return ;
+	}
+	how = Glushkov;
+	chunks = (n + 7) / 8;
+	followTable.assign((size_t)chunks * 256, 0ull);
+	for (int i = 0; i < chunks; ++i)
+		for (int b = 1; b < 256; ++b) {
+			int low = lowestBit((uint64_t)b);
+			int u = i * 8 + low;
+			followTable[(size_t)i * 256 + b] = followTable[(size_t)i * 256 + (b & (b - 1))] | (u < n ? followOf[u] : 0ull);
+		}
+	std::vector<uint64_t>().swap(wordTrans);
+}
+DeterministicFiniteAutomaton NondeterministicFiniteAutomaton::toDFA(int stateLimit) const {
+	if (n == 0)
+		RE("[Error] NFA::toDFA : Empty automaton.");
+	if (sig.empty())
+		RE("[Error] NFA::toDFA : Empty alphabet.");
+	if (startStates.empty())
+		RE("[Error] NFA::toDFA : No start state.");
+	Simulator sim(*this);
+	int m = sig.size(), k = sim.cols, words = sim.words;
+	// subsets back to back in sets, open addressing over their indices with their hashes kept aside
+	std::vector<uint64_t> sets, hashes;
+	std::vector<int> slots(1024, -1), rows, stack;
+	auto hashOf = [words](const uint64_t *set) {
+		uint64_t h = 1469598103934665603ull;
+		for (int w = 0; w < words; ++w) {
+			h = (h ^ set[w]) * 1099511628211ull;
+			h ^= h >> 29;
+		}
+		return h;
+	};
+	auto insert = [&](const uint64_t *set) -> int {
+		uint64_t h = hashOf(set);
+		size_t mask = slots.size() - 1;
+		for (size_t i = (size_t)h & mask; ; i = (i + 1) & mask) {
+			int s = slots[i];
+			if (s == -1)
+				break;
+			if (hashes[s] == h && std::equal(set, set + words, sets.begin() + (size_t)s * words))
+				return s;
+		}
+		int t = (int)hashes.size();
+		if (t >= stateLimit)
+			RE("[Error] NFA::toDFA : More than %d states.", stateLimit);
+		sets.insert(sets.end(), set, set + words);
+		hashes.push_back(h);
+		if ((size_t)(t + 1) * 2 > slots.size()) {
+			slots.assign(slots.size() * 2, -1);
+			mask = slots.size() - 1;
+			for (int s = 0; s <= t; ++s) {
+				size_t i = (size_t)hashes[s] & mask;
+				while (slots[i] != -1)
+					i = (i + 1) & mask;
+				slots[i] = s;
+			}
+		}
+		else {
+			size_t i = (size_t)h & mask;
+			while (slots[i] != -1)
+				i = (i + 1) & mask;
+			slots[i] = t;
+		}
+		return t;
+	};
+	insert(sim.startSet.data());
+	std::vector<uint64_t> from(words), to(words);
+	for (int s = 0; s < (int)hashes.size(); ++s) {
+		std::copy(sets.begin() + (size_t)s * words, sets.begin() + (size_t)(s + 1) * words, from.begin());
+		for (int c = 0; c < k; ++c) {
+			sim.step(from.data(), c, to.data(), stack);
+			bool nonempty = false;
+			for (int w = 0; w < words && !nonempty; ++w)
+				nonempty = to[w] != 0;
+			rows.push_back(nonempty ? insert(to.data()) : -1);
+		}
+	}
+	int cnt = (int)hashes.size();
+	// runs of symbol ids in one column whose symbols follow each other, for setTransitionRange
+	std::vector<int> runEnd(m);
+	for (int j = m - 1; j >= 0; --j)
+		runEnd[j] = j + 1 < m && sim.classOf[j + 1] == sim.classOf[j] && sig.i2c(j + 1) == sig.i2c(j) + 1 ? runEnd[j + 1] : j;
+	DeterministicFiniteAutomaton ret(sig);
+	ret.useSparseTransitions();
+	ret.setSize(cnt);
+	size_t ranges = 0;
+	for (int s = 0; s < cnt; ++s) {
+		// consecutive runs with the same target end up in one range of the row
+		for (int lo = 0, last = -1; lo < m; lo = runEnd[lo] + 1) {
+			int t = rows[(size_t)s * k + sim.classOf[lo]];
+			if (t != -1) {
+				ret.setTransitionRange(ret[s], sig.i2c(lo), sig.i2c(runEnd[lo]), ret[t]);
+				ranges += t != last;
+			}
+			last = t;
+		}
+		bool accept = false;
+		for (int w = 0; w < words && !accept; ++w)
+			accept = (sets[(size_t)s * words + w] & sim.acceptSet[w]) != 0;
+		if (accept)
+			ret.flipStateAcceptance(ret[s]);
+	}
+	ret.setStartState(ret[0]);
+	// the simulator's columns are at least as fine as the classes compressAlphabet finds
+	std::pair<size_t, size_t> bytes = DeterministicFiniteAutomaton::layoutBytes(cnt, m, k, ranges);
+	if (bytes.first < bytes.second)
+		ret.compressAlphabet();
+	return ret;
+}
+
+#undef RE
+
+#endif
@@ -0,0 +1,496 @@
+// PinkRabbit
+// 2026-10-16
+// Regular expressions over an Alphabet, Thompson NFA and a lazily built DFA
+
+#ifndef REGEX_H__PINKRABBIT
+#define REGEX_H__PINKRABBIT
+
+#include "DFA.h"
+#include <unordered_map>
+
+#define RE(...) void(), std::fprintf(stderr, __VA_ARGS__), std::exit(23), void()
+
+// supported syntax:
+// literals, escapes \x (\d \w \s \n \t \r are classes/controls), '.' for any symbol of the alphabet,
+// [...] and [^...] classes with ranges, grouping (...), alternation |, postfix * + ? {n} {n,} {n,m}
+// classes and '.' only keep the symbols which belong to the alphabet
+class RegularExpression {
+private:
+	struct AstNode {
+		int kind; // 0 empty, 1 symbol set, 2 concat, 3 alternation, 4 repeat
+		int set;
+		int lo, hi; // repeat bounds, hi = -1 for unbounded
+		std::vector<int> ch;
+	};
+	struct NfaNode {
+		int set; // -1 for an epsilon node
+		int out, out1;
+	};
+	struct VectorHash {
+		size_t operator () (const std::vector<int> &v) const {
+			size_t h = 1469598103934665603ull;
+			for (int x : v)
+				h = (h ^ (size_t)(unsigned)x) * 1099511628211ull;
+			return h;
+		}
+	};
+	// subset states built so far, rows[s * m + j] is -2 if not computed yet, -1 for the empty set
+	struct SubsetCache {
+		std::vector<std::vector<int>> sets;
+		std::unordered_map<std::vector<int>, int, VectorHash> index;
+		std::vector<int> rows;
+		std::vector<unsigned char> accepting;
+		size_t bytes;
+		SubsetCache() : bytes(0) {}
+		void clear() {
+			sets.clear();
+			index.clear();
+			rows.clear();
+			accepting.clear();
+			bytes = 0;
+		}
+	};
+	static const int maxRepeat = 1000;
+	Alphabet sig;
+	std::string pat;
+	std::vector<std::vector<unsigned char>> symbolSets;
+	std::vector<AstNode> ast;
+	std::vector<NfaNode> nfa;
+	int nfaStart, nfaAccept;
+	std::vector<int> startSet;
+	mutable std::vector<int> closureStamp;
+	mutable int closureRound;
+	SubsetCache cache;
+	size_t capacity;
+	int flushes;
+
+	// parser
+	size_t pos;
+	int newAst(int kind) {
+		AstNode node;
+		node.kind = kind, node.set = -1, node.lo = node.hi = 0;
+		ast.push_back(node);
+		return (int)ast.size() - 1;
+	}
+	int newSet() {
+		symbolSets.push_back(std::vector<unsigned char>(sig.size(), 0u));
+		return (int)symbolSets.size() - 1;
+	}
+	void addSymbol(int set, int c) {
+		int id = sig.lookup(c);
+		if (id >= 0 && id < sig.size())
+			symbolSets[set][id] = 1u;
+	}
+	void addRange(int set, int lo, int hi) {
+		for (int c = lo; c <= hi; ++c)
+			addSymbol(set, c);
+	}
+	bool addEscapeClass(int set, int c) {
+		if (c == 'd')
+			return addRange(set, '0', '9'), true;
+		if (c == 'w')
+			return addRange(set, 'a', 'z'), addRange(set, 'A', 'Z'), addRange(set, '0', '9'), addSymbol(set, '_'), true;
+		if (c == 's')
+			return addSymbol(set, ' '), addRange(set, '\t', '\r'), true;
+		return false;
+	}
+	static int escapedChar(int c) {
+		if (c == 'n')
+			return '\n';
+		if (c == 't')
+			return '\t';
+		if (c == 'r')
+			return '\r';
+		return c;
+	}
+	int peek() const {
+		return pos < pat.length() ? (int)pat[pos] : -1;
+	}
+	// compared by hand, std::isdigit is undefined for the negative values of bytes >= 0x80
+	bool digitNext() const {
+		int c = peek();
+		return c >= '0' && c <= '9';
+	}
+	int parseAlternation() {
+		int first = parseConcat();
+		if (peek() != '|')
+			return first;
+		int node = newAst(3);
+		ast[node].ch.push_back(first);
+		while (peek() == '|') {
+			++pos;
+			int next = parseConcat();
+			ast[node].ch.push_back(next);
+		}
+		return node;
+	}
+	int parseConcat() {
+		int node = newAst(2);
+		while (pos < pat.length() && peek() != '|' && peek() != ')') {
+			int next = parseRepeat();
+			ast[node].ch.push_back(next);
+		}
+		if (ast[node].ch.empty())
+			ast[node].kind = 0;
+		return node;
+	}
+	int parseNumber() {
+		if (!digitNext())
+			RE("[Error] Regex : Expected a number at position %d in \"%s\".", (int)pos, pat.c_str());
+		int x = 0;
+		while (digitNext()) {
+			x = x * 10 + (pat[pos++] - '0');
+			if (x > maxRepeat)
+				RE("[Error] Regex : Repetition count exceeds %d in \"%s\".", maxRepeat, pat.c_str());
+		}
+		return x;
+	}
+	int parseRepeat() {
+		int node = parseAtom();
+		while (true) {
+			int c = peek(), lo, hi;
+			if (c == '*')
+				lo = 0, hi = -1, ++pos;
+			else if (c == '+')
+				lo = 1, hi = -1, ++pos;
+			else if (c == '?')
+				lo = 0, hi = 1, ++pos;
+			else if (c == '{') {
+				++pos;
+				lo = hi = parseNumber();
+				if (peek() == ',') {
+					++pos;
+					hi = peek() == '}' ? -1 : parseNumber();
+				}
+				if (peek() != '}')
+					RE("[Error] Regex : Expected \'}\' at position %d in \"%s\".", (int)pos, pat.c_str());
+				++pos;
+				if (hi != -1 && hi < lo)
+					RE("[Error] Regex : Invalid repetition {%d,%d} in \"%s\".", lo, hi, pat.c_str());
+			}
+			else
+				return node;
+			int rep = newAst(4);
+			ast[rep].lo = lo, ast[rep].hi = hi;
+			ast[rep].ch.push_back(node);
+			node = rep;
+		}
+	}
+	int parseAtom() {
+		int c = peek();
+		if (c == '(') {
+			++pos;
+			int node = parseAlternation();
+			if (peek() != ')')
+				RE("[Error] Regex : Unmatched \'(\' in \"%s\".", pat.c_str());
+			++pos;
+			return node;
+		}
+		if (c == '*' || c == '+' || c == '?' || c == '{')
+			RE("[Error] Regex : Nothing to repeat at position %d in \"%s\".", (int)pos, pat.c_str());
+		int node = newAst(1);
+		int set = newSet();
+		ast[node].set = set;
+		++pos;
+		if (c == '.')
+			std::fill(symbolSets[set].begin(), symbolSets[set].end(), (unsigned char)1u);
+		else if (c == '[')
+			parseClass(set);
+		else if (c == '\\') {
+			if (pos >= pat.length())
+				RE("[Error] Regex : Trailing \'\\\\\' in \"%s\".", pat.c_str());
+			int e = pat[pos++];
+			if (!addEscapeClass(set, e))
+				addLiteral(set, escapedChar(e));
+		}
+		else
+			addLiteral(set, c);
+		return node;
+	}
+	void addLiteral(int set, int c) {
+		int id = sig.lookup(c);
+		if (id < 0 || id >= sig.size())
+			RE("[Error] Regex : Symbol \'%s\' is not in the alphabet.", symbolize(c).c_str());
+		symbolSets[set][id] = 1u;
+	}
+	void parseClass(int set) {
+		bool negate = false;
+		if (peek() == '^')
+			negate = true, ++pos;
+		bool first = true;
+		while (true) {
+			if (pos >= pat.length())
+				RE("[Error] Regex : Unmatched \'[\' in \"%s\".", pat.c_str());
+			int c = pat[pos++];
+			if (c == ']' && !first)
+				break;
+			first = false;
+			if (c == '\\') {
+				if (pos >= pat.length())
+					RE("[Error] Regex : Unmatched \'[\' in \"%s\".", pat.c_str());
+				c = pat[pos++];
+				if (addEscapeClass(set, c))
+					continue;
+				c = escapedChar(c);
+			}
+			if (peek() == '-' && pos + 1 < pat.length() && pat[pos + 1] != ']') {
+				++pos;
+				int d = pat[pos++];
+				if (d == '\\') {
+					if (pos >= pat.length())
+						RE("[Error] Regex : Unmatched \'[\' in \"%s\".", pat.c_str());
+					d = escapedChar(pat[pos++]);
+				}
+				if (d < c)
+					RE("[Error] Regex : Invalid class range at position %d in \"%s\".", (int)pos, pat.c_str());
+				addRange(set, c, d);
+			}
+			else
+				addSymbol(set, c);
+		}
+		if (negate)
+			for (unsigned char &x : symbolSets[set])
+				x ^= 1u;
+	}
+
+	// Thompson construction, every fragment ends in an epsilon node without outgoing edges
+	int newNfa(int set, int out = -1, int out1 = -1) {
+		NfaNode node;
+		node.set = set, node.out = out, node.out1 = out1;
+		nfa.push_back(node);
+		return (int)nfa.size() - 1;
+	}
+	std::pair<int, int> build(int id) {
+		int kind = ast[id].kind;
+		if (kind == 0) {
+			int s = newNfa(-1);
+			return {s, s};
+		}
+		if (kind == 1) {
+			int e = newNfa(-1);
+			int s = newNfa(ast[id].set, e);
+			return {s, e};
+		}
+		if (kind == 2) {
+			std::pair<int, int> frag = build(ast[id].ch[0]);
+			for (size_t i = 1; i < ast[id].ch.size(); ++i) {
+				std::pair<int, int> next = build(ast[id].ch[i]);
+				nfa[frag.second].out = next.first;
+				frag.second = next.second;
+			}
+			return frag;
+		}
+		if (kind == 3) {
+			int e = newNfa(-1);
+			int s = -1;
+			for (int i = (int)ast[id].ch.size() - 1; i >= 0; --i) {
+				std::pair<int, int> alt = build(ast[id].ch[i]);
+				nfa[alt.second].out = e;
+				s = s == -1 ? alt.first : newNfa(-1, alt.first, s);
+			}
+			return {s, e};
+		}
+		int lo = ast[id].lo, hi = ast[id].hi, child = ast[id].ch[0];
+		int s = newNfa(-1), e = s;
+		for (int i = 0; i < lo; ++i) {
+			std::pair<int, int> next = build(child);
+			nfa[e].out = next.first;
+			e = next.second;
+		}
+		if (hi == -1) {
+			std::pair<int, int> loop = build(child);
+			int last = newNfa(-1);
+			nfa[e].out = loop.first, nfa[e].out1 = last;
+			nfa[loop.second].out = loop.first, nfa[loop.second].out1 = last;
+			return {s, last};
+		}
+		int last = newNfa(-1);
+		for (int i = lo; i < hi; ++i) {
+			std::pair<int, int> next = build(child);
+			nfa[e].out = next.first, nfa[e].out1 = last;
+			e = next.second;
+		}
+		nfa[e].out = last;
+		return {s, last};
+	}
+
+	// subset construction
+	void closure(std::vector<int> &set) const {
+		if (++closureRound == 0) {
+			std::fill(closureStamp.begin(), closureStamp.end(), 0);
+			closureRound = 1;
+		}
+		std::vector<int> stack(set);
+		set.clear();
+		for (int u : stack)
+			closureStamp[u] = closureRound;
+		while (!stack.empty()) {
+			int u = stack.back();
+			stack.pop_back();
+			set.push_back(u);
+			const NfaNode &node = nfa[u];
+			if (node.set != -1)
+				continue;
+			if (node.out != -1 && closureStamp[node.out] != closureRound)
+				closureStamp[node.out] = closureRound, stack.push_back(node.out);
+			if (node.out1 != -1 && closureStamp[node.out1] != closureRound)
+				closureStamp[node.out1] = closureRound, stack.push_back(node.out1);
+		}
+		std::sort(set.begin(), set.end());
+	}
+	std::vector<int> move(const std::vector<int> &set, int symbId) const {
+		std::vector<int> ret;
+		for (int u : set) {
+			const NfaNode &node = nfa[u];
+			if (node.set != -1 && symbolSets[node.set][symbId])
+				ret.push_back(node.out);
+		}
+		if (!ret.empty())
+			closure(ret);
+		return ret;
+	}
+	size_t stateBytes(const std::vector<int> &set) const {
+		return (size_t)sig.size() * sizeof(int) + 2 * set.size() * sizeof(int) + 96;
+	}
+	int addState(SubsetCache &c, const std::vector<int> &set) const {
+		std::unordered_map<std::vector<int>, int, VectorHash>::const_iterator it = c.index.find(set);
+		if (it != c.index.end())
+			return it->second;
+		int id = (int)c.sets.size();
+		c.sets.push_back(set);
+		c.index.emplace(set, id);
+		c.rows.resize(c.rows.size() + sig.size(), -2);
+		c.accepting.push_back((unsigned char)std::binary_search(set.begin(), set.end(), nfaAccept));
+		c.bytes += stateBytes(set);
+		return id;
+	}
+	void flush() {
+		cache.clear();
+		++flushes;
+		addState(cache, startSet);
+	}
+	// target of state s on symbId in the bounded cache, s is renumbered if the cache had to be flushed
+	int step(int &s, int symbId) {
+		int m = sig.size();
+		int t = cache.rows[(size_t)s * m + symbId];
+		if (t != -2)
+			return t;
+		std::vector<int> target = move(cache.sets[s], symbId);
+		if (target.empty()) {
+			cache.rows[(size_t)s * m + symbId] = -1;
+			return -1;
+		}
+		if (!cache.index.count(target) && cache.bytes + stateBytes(target) > capacity) {
+			std::vector<int> source = cache.sets[s];
+			flush();
+			s = addState(cache, source);
+		}
+		t = addState(cache, target);
+		cache.rows[(size_t)s * m + symbId] = t;
+		return t;
+	}
+public:
+	RegularExpression(const Alphabet &alph, const std::string &pattern, size_t cacheBytes = (size_t)1 << 22)
+		: sig(alph), pat(pattern), closureRound(0), capacity(cacheBytes), flushes(0), pos(0) {
+		if (sig.empty())
+			RE("[Error] Regex : Empty alphabet.");
+		int root = parseAlternation();
+		if (pos != pat.length())
+			RE("[Error] Regex : Unmatched \')\' at position %d in \"%s\".", (int)pos, pat.c_str());
+		std::pair<int, int> frag = build(root);
+		ast.clear();
+		nfaStart = frag.first, nfaAccept = frag.second;
+		closureStamp.assign(nfa.size(), 0);
+		startSet.assign(1, nfaStart);
+		closure(startSet);
+		addState(cache, startSet);
+	}
+	RegularExpression(const RegularExpression &) = default;
+	RegularExpression(RegularExpression &&) = default;
+	RegularExpression &operator = (const RegularExpression &) = default;
+	RegularExpression &operator = (RegularExpression &&) = default;
+	const std::string &pattern() const {
+		return pat;
+	}
+	const Alphabet &alphabet() const {
+		return sig;
+	}
+	int nfaSize() const {
+		return (int)nfa.size();
+	}
+	int cachedStates() const {
+		return (int)cache.sets.size();
+	}
+	size_t cacheBytes() const {
+		return cache.bytes;
+	}
+	int cacheFlushes() const {
+		return flushes;
+	}
+	void setCacheCapacity(size_t bytes) {
+		capacity = bytes;
+		if (cache.bytes > capacity)
+			flush();
+	}
+	// anchored match of the whole input, builds the DFA states it meets on the way
+	bool match(const char *first, const char *last) {
+		int m = sig.size();
+		int s = 0;
+		for (; first != last; ++first) {
+			int c = (int)*first;
+			int symbId = sig.lookup(c);
+			if (symbId < 0 || symbId >= m)
+				sig.c2i(c);
+			if (s == -1)
+				continue;
+			int t = cache.rows[(size_t)s * m + symbId];
+			s = t >= -1 ? t : step(s, symbId);
+		}
+		return s != -1 && cache.accepting[s];
+	}
+	bool match(const std::string &str) {
+		return match(str.data(), str.data() + str.length());
+	}
+	// full subset construction, the empty set becomes a sink so the result is complete
+	DeterministicFiniteAutomaton toDFA(int stateLimit = 1 << 22) const {
+		SubsetCache c;
+		addState(c, startSet);
+		int m = sig.size();
+		bool needSink = false;
+		for (int s = 0; s < (int)c.sets.size(); ++s) {
+			for (int j = 0; j < m; ++j) {
+				std::vector<int> target = move(c.sets[s], j);
+				int t = -1;
+				if (!target.empty())
+					t = addState(c, target);
+				else
+					needSink = true;
+				c.rows[(size_t)s * m + j] = t;
+				if ((int)c.sets.size() + (int)needSink > stateLimit)
+					RE("[Error] Regex::toDFA : More than %d states.", stateLimit);
+			}
+		}
+		int cnt = (int)c.sets.size();
+		int sink = needSink ? cnt : -1;
+		DeterministicFiniteAutomaton ret(sig);
+		ret.setSize(cnt + (int)needSink);
+		for (int s = 0; s < cnt; ++s)
+			for (int j = 0; j < m; ++j) {
+				int t = c.rows[(size_t)s * m + j];
+				ret.setTransition(ret[s], sig.i2c(j), ret[t == -1 ? sink : t]);
+			}
+		if (needSink)
+			for (int j = 0; j < m; ++j)
+				ret.setTransition(ret[sink], sig.i2c(j), ret[sink]);
+		for (int s = 0; s < cnt; ++s)
+			if (c.accepting[s])
+				ret.flipStateAcceptance(ret[s]);
+		ret.setStartState(ret[0]);
+		return ret;
+	}
+	~RegularExpression() = default;
+};
+
+#undef RE
+
+#endif
@@ -0,0 +1,474 @@
+// PinkRabbit
+// 2026-10-16
+// Many DFAs matched against one input together, by lazily built products of the rules sharing an alphabet
+
+#ifndef RULESET_H__PINKRABBIT
+#define RULESET_H__PINKRABBIT
+
+#include "DFA.h"
+
+#define RE(...) void(), std::fprintf(stderr, __VA_ARGS__), std::exit(23), void()
+
+// rules get ids 0, 1, .. in order of addition, then build() groups them, a rule matches an input when its automaton accepts all of it,
+// a symbol out of the alphabet of a rule makes only that rule reject
+// build() puts up to groupRules rules of the same alphabet into a group whose product automaton is made lazily:
+// a product state is the tuple of the states of the rules, with the rules accepting there as a bitmask,
+// and its transitions are filled in on first use, so only the tuples met in the inputs are ever made
+// a group keeps at most stateLimit tuples and starts over from the current one when it needs more,
+// if it fills up within thrashSteps steps per tuple its rules are stepped one by one from then on (interleaved),
+// as are the rules whose alphabet no other rule has
+// inputs are read in blocks of blockSize symbols and every group runs over a block while it is in the cache,
+// so the input is read from memory once however many rules there are
+// matching fills the caches, so a rule set is not shared between threads, its copies are independent
+class RuleSet {
+private:
+	static const int blockSize = 1 << 12;
+	static const int thrashSteps = 4;
+	struct Rule {
+		int alph, cols, start; // column cols is for the symbols out of the alphabet
+		int dead; // the last row, a rejecting sink for empty transitions and the states which cannot reach an accept state
+		std::vector<int> classOf; // column of every symbol id
+		int byteClass[256];
+		std::vector<int> table; // cols + 1 entries per state
+		std::vector<unsigned char> accept;
+	};
+	struct Group {
+		std::vector<int> members;
+		bool interleaved;
+		// the product, over the joint classes of the members' columns, column cols is for the symbols out of the alphabet
+		int cols;
+		int byteCol[256];
+		std::vector<int> symbolCol;
+		std::vector<int> memberCol; // column of member i for the group column c at i * (cols + 1) + c
+		std::vector<int> tuples; // members.size() entries per product state
+		std::vector<uint64_t> hashes, acceptMask;
+		std::vector<int> slots, next; // next: cols + 1 entries per product state, -1 while unknown
+		std::vector<int> scratch;
+		int startState, deadState;
+		size_t stepsSinceFlush;
+		int flushes;
+		// while matching, the product state or the states of the members
+		int at;
+		std::vector<int> cur;
+	};
+	std::vector<Alphabet> alphabets;
+	std::unordered_multimap<uint64_t, int> alphabetOfHash;
+	std::vector<Rule> rules;
+	std::vector<Group> groups;
+	bool built;
+	int stateLimit;
+	void checkBuilt(bool want, const char *func) const {
+		if (built != want)
+			RE("[Error] RuleSet::%s : %s", func, want ? "Call build() first." : "Already built.");
+	}
+	// alphabets are the same when they map every symbol id to the same symbol
+	int alphabetId(const Alphabet &sig) {
+		int m = sig.size();
+		uint64_t h = (uint64_t)m;
+		for (int j = 0; j < m; ++j)
+			h = (h ^ (uint64_t)(unsigned)sig.i2c(j)) * 0x100000001B3ull;
+		auto range = alphabetOfHash.equal_range(h);
+		for (auto it = range.first; it != range.second; ++it) {
+			const Alphabet &other = alphabets[it->second];
+			bool same = other.size() == m;
+			for (int j = 0; j < m && same; ++j)
+				same = other.i2c(j) == sig.i2c(j);
+			if (same)
+				return it->second;
+		}
+		alphabets.push_back(sig);
+		alphabetOfHash.emplace(h, (int)alphabets.size() - 1);
+		return (int)alphabets.size() - 1;
+	}
+	static uint64_t hashOf(const int *tuple, int g) {
+		uint64_t h = 1469598103934665603ull;
+		for (int i = 0; i < g; ++i) {
+			h = (h ^ (uint64_t)(unsigned)tuple[i]) * 1099511628211ull;
+			h ^= h >> 29;
+		}
+		return h;
+	}
+	void makeProduct(Group &G) {
+		const Alphabet &sig = alphabets[rules[G.members[0]].alph];
+		int m = sig.size(), g = (int)G.members.size();
+		// symbols with the same column in every member share a group column
+		std::vector<int> represent;
+		std::unordered_multimap<uint64_t, int> colOfHash;
+		G.symbolCol.assign(m, -1);
+		for (int j = 0; j < m; ++j) {
+			uint64_t h = 1469598103934665603ull;
+			for (int i = 0; i < g; ++i)
+				h = (h ^ (uint64_t)rules[G.members[i]].classOf[j]) * 1099511628211ull;
+			auto range = colOfHash.equal_range(h);
+			for (auto it = range.first; it != range.second && G.symbolCol[j] == -1; ++it) {
+				bool same = true;
+				for (int i = 0; i < g && same; ++i)
+					same = rules[G.members[i]].classOf[j] == rules[G.members[i]].classOf[represent[it->second]];
+				if (same)
+					G.symbolCol[j] = it->second;
+			}
+			if (G.symbolCol[j] == -1) {
+				G.symbolCol[j] = (int)represent.size();
+				colOfHash.emplace(h, (int)represent.size());
+				represent.push_back(j);
+			}
+		}
+		int k = G.cols = (int)represent.size();
+		G.memberCol.resize((size_t)g * (k + 1));
+		for (int i = 0; i < g; ++i) {
+			const Rule &r = rules[G.members[i]];
+			for (int c = 0; c < k; ++c)
+				G.memberCol[(size_t)i * (k + 1) + c] = r.classOf[represent[c]];
+			G.memberCol[(size_t)i * (k + 1) + k] = r.cols;
+		}
+		for (int b = 0; b < 256; ++b) {
+			int symbId = sig.lookup((int)(char)b);
+			G.byteCol[b] = symbId >= 0 && symbId < m ? G.symbolCol[symbId] : k;
+		}
+		G.scratch.resize(g);
+		G.flushes = 0;
+		flush(G);
+	}
+	static void flush(Group &G) {
+		G.tuples.clear(), G.hashes.clear(), G.acceptMask.clear(), G.next.clear();
+		G.slots.assign(1024, -1);
+		G.startState = G.deadState = -1;
+		G.stepsSinceFlush = 0;
+	}
+	int lookup(const Group &G, const int *tuple, uint64_t h) const {
+		int g = (int)G.members.size();
+		size_t mask = G.slots.size() - 1;
+		for (size_t i = (size_t)h & mask; G.slots[i] != -1; i = (i + 1) & mask) {
+			int s = G.slots[i];
+			if (G.hashes[s] == h && std::equal(tuple, tuple + g, G.tuples.begin() + (size_t)s * g))
+				return s;
+		}
+		return -1;
+	}
+	int insert(Group &G, const int *tuple, uint64_t h) {
+		int g = (int)G.members.size(), t = (int)G.hashes.size();
+		G.tuples.insert(G.tuples.end(), tuple, tuple + g);
+		G.hashes.push_back(h);
+		G.next.resize((size_t)(t + 1) * (G.cols + 1), -1);
+		uint64_t accept = 0;
+		bool live = false;
+		for (int i = 0; i < g; ++i) {
+			live |= tuple[i] != rules[G.members[i]].dead;
+			accept |= (uint64_t)rules[G.members[i]].accept[tuple[i]] << i;
+		}
+		G.acceptMask.push_back(accept);
+		if (!live)
+			G.deadState = t;
+		// the new state alone, or all of them once the table grows
+		bool grow = (size_t)(t + 1) * 2 > G.slots.size();
+		if (grow)
+			G.slots.assign(G.slots.size() * 2, -1);
+		size_t mask = G.slots.size() - 1;
+		for (int s = grow ? 0 : t; s <= t; ++s) {
+			size_t i = (size_t)G.hashes[s] & mask;
+			while (G.slots[i] != -1)
+				i = (i + 1) & mask;
+			G.slots[i] = s;
+		}
+		return t;
+	}
+	// the product state of a tuple, starting over first if the group is full,
+	// -1 when the group turns to interleaved stepping instead, the tuple is left in cur then
+	int place(Group &G, const int *tuple) {
+		uint64_t h = hashOf(tuple, (int)G.members.size());
+		int t = lookup(G, tuple, h);
+		if (t != -1)
+			return t;
+		if ((int)G.hashes.size() >= stateLimit) {
+			if (G.stepsSinceFlush < (size_t)stateLimit * thrashSteps) {
+				G.interleaved = true;
+				G.cur.assign(tuple, tuple + G.members.size());
+				std::vector<int>().swap(G.tuples), std::vector<int>().swap(G.next), std::vector<int>().swap(G.slots);
+				std::vector<uint64_t>().swap(G.hashes), std::vector<uint64_t>().swap(G.acceptMask);
+				return -1;
+			}
+			flush(G);
+			++G.flushes;
+		}
+		return insert(G, tuple, h);
+	}
+	int successor(Group &G, int s, int c) {
+		int g = (int)G.members.size(), k = G.cols + 1;
+		for (int i = 0; i < g; ++i) {
+			int u = G.tuples[(size_t)s * g + i];
+			const Rule &r = rules[G.members[i]];
+			G.scratch[i] = r.table[(size_t)u * (r.cols + 1) + G.memberCol[(size_t)i * k + c]];
+		}
+		int flushes = G.flushes;
+		int t = place(G, G.scratch.data());
+		// s is gone if the group started over
+		if (t != -1 && G.flushes == flushes)
+			G.next[(size_t)s * k + c] = t;
+		return t;
+	}
+	int groupColumn(const Group &G, char ch) const {
+		return G.byteCol[(unsigned char)ch];
+	}
+	int groupColumn(const Group &G, int x) const {
+		int symbId = alphabets[rules[G.members[0]].alph].lookup(x);
+		return symbId >= 0 && symbId < (int)G.symbolCol.size() ? G.symbolCol[symbId] : G.cols;
+	}
+	int ruleColumn(const Rule &r, char ch) const {
+		return r.byteClass[(unsigned char)ch];
+	}
+	int ruleColumn(const Rule &r, int x) const {
+		int symbId = alphabets[r.alph].lookup(x);
+		return symbId >= 0 && symbId < (int)r.classOf.size() ? r.classOf[symbId] : r.cols;
+	}
+	// returns where the group turned to interleaved stepping, or last
+	template <typename C>
+	const C *runProduct(Group &G, const C *first, const C *last) {
+		int s = G.at, k = G.cols + 1;
+		const C *p = first;
+		for (; p != last && s != G.deadState; ) {
+			int c = groupColumn(G, *p++);
+			int t = G.next[(size_t)s * k + c];
+			if (t == -1) {
+				G.stepsSinceFlush += (size_t)(p - first);
+				first = p;
+				t = successor(G, s, c);
+				if (t == -1)
+					return p;
+			}
+			s = t;
+		}
+		G.stepsSinceFlush += (size_t)(p - first);
+		G.at = s;
+		return last;
+	}
+	// four rules at a time in lockstep so that their table loads overlap, a dead rule stays in its sink
+	template <typename C>
+	void runInterleaved(Group &G, const C *first, const C *last) {
+		size_t g = G.members.size(), i = 0;
+		for (; i + 4 <= g; i += 4) {
+			const Rule &a = rules[G.members[i]], &b = rules[G.members[i + 1]];
+			const Rule &c = rules[G.members[i + 2]], &d = rules[G.members[i + 3]];
+			int ua = G.cur[i], ub = G.cur[i + 1], uc = G.cur[i + 2], ud = G.cur[i + 3];
+			if (ua == a.dead && ub == b.dead && uc == c.dead && ud == d.dead)
+				continue;
+			for (const C *p = first; p != last; ++p) {
+				ua = a.table[(size_t)ua * (a.cols + 1) + ruleColumn(a, *p)];
+				ub = b.table[(size_t)ub * (b.cols + 1) + ruleColumn(b, *p)];
+				uc = c.table[(size_t)uc * (c.cols + 1) + ruleColumn(c, *p)];
+				ud = d.table[(size_t)ud * (d.cols + 1) + ruleColumn(d, *p)];
+			}
+			G.cur[i] = ua, G.cur[i + 1] = ub, G.cur[i + 2] = uc, G.cur[i + 3] = ud;
+		}
+		for (; i < g; ++i) {
+			const Rule &r = rules[G.members[i]];
+			int u = G.cur[i], k = r.cols + 1;
+			for (const C *p = first; p != last && u != r.dead; ++p)
+				u = r.table[(size_t)u * k + ruleColumn(r, *p)];
+			G.cur[i] = u;
+		}
+	}
+	template <typename C>
+	void run(const C *first, const C *last, std::vector<uint64_t> &mask) {
+		checkBuilt(true, "match");
+		mask.assign((rules.size() + 63) / 64, 0ull);
+		for (Group &G : groups) {
+			if (G.interleaved) {
+				G.cur.resize(G.members.size());
+				for (size_t i = 0; i < G.members.size(); ++i)
+					G.cur[i] = rules[G.members[i]].start;
+				continue;
+			}
+			if (G.startState == -1) {
+				for (size_t i = 0; i < G.members.size(); ++i)
+					G.scratch[i] = rules[G.members[i]].start;
+				G.startState = place(G, G.scratch.data());
+				if (G.startState == -1)
+					continue;
+			}
+			G.at = G.startState;
+		}
+		for (const C *p = first, *q; p != last; p = q) {
+			q = last - p > blockSize ? p + blockSize : last;
+			for (Group &G : groups) {
+				const C *from = G.interleaved ? p : runProduct(G, p, q);
+				if (G.interleaved)
+					runInterleaved(G, from, q);
+			}
+		}
+		for (const Group &G : groups)
+			for (size_t i = 0; i < G.members.size(); ++i) {
+				int id = G.members[i];
+				bool accept = G.interleaved ? rules[id].accept[G.cur[i]] != 0 : (G.acceptMask[G.at] >> i & 1u) != 0;
+				if (accept)
+					mask[id >> 6] |= 1ull << (id & 63);
+			}
+	}
+	static std::vector<int> ids(const std::vector<uint64_t> &mask) {
+		std::vector<int> ret;
+		for (size_t w = 0; w < mask.size(); ++w)
+			for (uint64_t x = mask[w]; x; x &= x - 1) {
+				int b = 0;
+				while (!(x >> b & 1u))
+					++b;
+				ret.push_back((int)w * 64 + b);
+			}
+		return ret;
+	}
+public:
+	RuleSet() : built(false), stateLimit(0) {}
+	RuleSet(const RuleSet &) = default;
+	RuleSet(RuleSet &&) = default;
+	RuleSet &operator = (const RuleSet &) = default;
+	RuleSet &operator = (RuleSet &&) = default;
+	// the rule keeps a copy of the automaton's transitions, returns the rule id
+	int addRule(const DeterministicFiniteAutomaton &dfa);
+	// groupRules in [1, 64], with 1 every rule is stepped on its own
+	void build(int groupRules = 64, int limit = 1 << 12);
+	int size() const {
+		return (int)rules.size();
+	}
+	int groupCount() const {
+		checkBuilt(true, "groupCount");
+		return (int)groups.size();
+	}
+	// rules in groups which step their rules one by one
+	int interleavedRules() const {
+		checkBuilt(true, "interleavedRules");
+		int ret = 0;
+		for (const Group &G : groups)
+			ret += G.interleaved ? (int)G.members.size() : 0;
+		return ret;
+	}
+	// product states kept over all groups, and how many times a group started over
+	int cachedStates() const {
+		checkBuilt(true, "cachedStates");
+		int ret = 0;
+		for (const Group &G : groups)
+			ret += (int)G.hashes.size();
+		return ret;
+	}
+	int flushes() const {
+		checkBuilt(true, "flushes");
+		int ret = 0;
+		for (const Group &G : groups)
+			ret += G.interleaved ? 0 : G.flushes;
+		return ret;
+	}
+	// rule id i matches when bit i & 63 of mask[i >> 6] is set
+	void match(const char *first, const char *last, std::vector<uint64_t> &mask) {
+		run(first, last, mask);
+	}
+	void match(const int *first, const int *last, std::vector<uint64_t> &mask) {
+		run(first, last, mask);
+	}
+	// ids of the matching rules in increasing order
+	std::vector<int> match(const std::string &symbString) {
+		std::vector<uint64_t> mask;
+		run(symbString.data(), symbString.data() + symbString.length(), mask);
+		return ids(mask);
+	}
+	std::vector<int> match(const std::vector<int> &symbols) {
+		std::vector<uint64_t> mask;
+		run(symbols.data(), symbols.data() + symbols.size(), mask);
+		return ids(mask);
+	}
+	~RuleSet() = default;
+};
+
+int RuleSet::addRule(const DeterministicFiniteAutomaton &dfa) {
+	checkBuilt(false, "addRule");
+	if (dfa.empty())
+		RE("[Error] RuleSet::addRule : Empty automaton.");
+	if (dfa.alphabetEmpty())
+		RE("[Error] RuleSet::addRule : Empty alphabet.");
+	const Alphabet &sig = dfa.alphabet();
+	int n = dfa.size(), m = sig.size();
+	Rule r;
+	r.alph = alphabetId(sig);
+	r.classOf = dfa.symbolClasses();
+	int k = r.cols = *std::max_element(r.classOf.begin(), r.classOf.end()) + 1;
+	std::vector<int> represent(k, -1);
+	for (int j = m - 1; j >= 0; --j)
+		represent[r.classOf[j]] = j;
+	std::vector<int> tab((size_t)n * k);
+	r.accept.assign(n + 1, 0u);
+	for (int u = 0; u < n; ++u) {
+		DeterministicFiniteAutomaton::State state = dfa[u];
+		for (int c = 0; c < k; ++c)
+			tab[(size_t)u * k + c] = state.transition(sig.i2c(represent[c])).index();
+		r.accept[u] = (unsigned char)state.accept();
+	}
+	// live states reach an accept state, the others are dropped so that a dead rule stops early
+	std::vector<int> invBegin(n + 1, 0), invSrc((size_t)n * k), que;
+	for (size_t e = 0; e < tab.size(); ++e)
+		if (tab[e] != -1)
+			++invBegin[tab[e] + 1];
+	for (int u = 0; u < n; ++u)
+		invBegin[u + 1] += invBegin[u];
+	{
+		std::vector<int> pos(invBegin.begin(), invBegin.end() - 1);
+		for (size_t e = 0; e < tab.size(); ++e)
+			if (tab[e] != -1)
+				invSrc[pos[tab[e]]++] = (int)(e / k);
+	}
+	std::vector<unsigned char> live(n, 0u);
+	for (int u = 0; u < n; ++u)
+		if (r.accept[u])
+			live[u] = 1u, que.push_back(u);
+	for (size_t h = 0; h < que.size(); ++h)
+		for (int i = invBegin[que[h]]; i < invBegin[que[h] + 1]; ++i)
+			if (!live[invSrc[i]])
+				live[invSrc[i]] = 1u, que.push_back(invSrc[i]);
+	r.dead = n;
+	r.table.assign((size_t)(n + 1) * (k + 1), n);
+	for (int u = 0; u < n; ++u)
+		for (int c = 0; live[u] && c < k; ++c) {
+			int v = tab[(size_t)u * k + c];
+			if (v != -1 && live[v])
+				r.table[(size_t)u * (k + 1) + c] = v;
+		}
+	r.start = dfa.start().index();
+	if (r.start == -1 || !live[r.start])
+		r.start = n;
+	for (int b = 0; b < 256; ++b) {
+		int symbId = sig.lookup((int)(char)b);
+		r.byteClass[b] = symbId >= 0 && symbId < m ? r.classOf[symbId] : k;
+	}
+	rules.push_back(std::move(r));
+	return (int)rules.size() - 1;
+}
+void RuleSet::build(int groupRules, int limit) {
+	checkBuilt(false, "build");
+	if (groupRules < 1 || groupRules > 64)
+		RE("[Error] RuleSet::build : Provided group size (%d) violates the range [1, 64].", groupRules);
+	if (limit < 2)
+		RE("[Error] RuleSet::build : Provided state limit (%d) is less than 2.", limit);
+	stateLimit = limit;
+	std::vector<std::vector<int>> byAlphabet(alphabets.size());
+	for (int id = 0; id < (int)rules.size(); ++id)
+		byAlphabet[rules[id].alph].push_back(id);
+	Group loose;
+	loose.interleaved = true;
+	for (const std::vector<int> &list : byAlphabet) {
+		// groups of nearly the same size, a group of one rule is stepped with the loose rules
+		int cnt = ((int)list.size() + groupRules - 1) / groupRules;
+		for (int i = 0; i < cnt; ++i) {
+			std::vector<int> members(list.begin() + list.size() * i / cnt, list.begin() + list.size() * (i + 1) / cnt);
+			if (members.size() == 1) {
+				loose.members.push_back(members[0]);
+				continue;
+			}
+			groups.emplace_back();
+			groups.back().members.swap(members);
+			groups.back().interleaved = false;
+			makeProduct(groups.back());
+		}
+	}
+	if (!loose.members.empty())
+		groups.push_back(std::move(loose));
+	built = true;
+}
+
+#undef RE
+
+#endif
@@ -0,0 +1,267 @@
+// PinkRabbit
+// 2026-10-16
+// Deterministic finite automata fixed at compile time, tables are constexpr arrays (C++14)
+
+#ifndef STATICDFA_H__PINKRABBIT
+#define STATICDFA_H__PINKRABBIT
+
+#include "DFA.h"
+
+#if __cplusplus >= 201402L
+
+#define RE(...) void(), std::fprintf(stderr, __VA_ARGS__), std::exit(23), void()
+
+// N states, M symbols, states are plain indices and -1 is the missing state
+// every member function except toDFA can run in constant evaluation, an error there fails the compilation
+template <int N, int M>
+class StaticDeterministicFiniteAutomaton {
+	static_assert(N > 0, "StaticDFA : at least one state is needed.");
+	static_assert(M > 0, "StaticDFA : at least one symbol is needed.");
+	template <int, int>
+	friend class StaticDeterministicFiniteAutomaton;
+private:
+	int symbols[M];
+	int byteId[256]; // symbol id of every char value, indexed by its unsigned byte
+	int table[N][M];
+	bool acceptStates[N];
+	int startStateIndex;
+	constexpr void checkState(int index, const char *func) const {
+		if (index < 0 || index >= N)
+			RE("[Error] StaticDFA::%s : Invalid state internal index (%d) violates the range [0, %d].", func, index, N - 1);
+	}
+	constexpr int symbolIdChecked(int c, const char *func) const {
+		int symbId = symbolId(c);
+		if (symbId == -1)
+			RE("[Error] StaticDFA::%s : Invalid symbol \'%s\' is not in the alphabet.", func, symbolize(c).c_str());
+		return symbId;
+	}
+	// Moore's refinement over the states reachable from the start state, with an extra dead state N
+	// when some of them miss a transition, as the dynamic minimize does for partial automata,
+	// states equivalent to the dead state are dropped, the start state is kept alone if it is one of them,
+	// newId[u] is the state of u in the minimal automaton (-1 if dropped), rep[k] a state of class k
+	constexpr int minimalClasses(int (&newId)[N], int (&rep)[N]) const {
+		bool reach[N + 1] = {};
+		int que[N] = {}, tail = 0;
+		reach[startStateIndex] = true;
+		que[tail++] = startStateIndex;
+		bool partial = false;
+		for (int h = 0; h < tail; ++h)
+			for (int j = 0; j < M; ++j) {
+				int v = table[que[h]][j];
+				if (v == -1)
+					partial = true;
+				else if (!reach[v]) {
+					reach[v] = true;
+					que[tail++] = v;
+				}
+			}
+		reach[N] = partial;
+		int cls[N + 1] = {}, next[N + 1] = {}, count = 0;
+		for (int u = 0; u <= N; ++u)
+			cls[u] = u < N && acceptStates[u];
+		for (int before = -1; count != before; ) {
+			before = count;
+			count = 0;
+			for (int u = 0; u <= N; ++u) {
+				if (!reach[u])
+					continue;
+				next[u] = -1;
+				for (int w = 0; w < u && next[u] == -1; ++w) {
+					if (!reach[w] || cls[w] != cls[u])
+						continue;
+					bool same = true;
+					for (int j = 0; j < M && same; ++j) {
+						int a = u == N || table[u][j] == -1 ? N : table[u][j];
+						int b = w == N || table[w][j] == -1 ? N : table[w][j];
+						same = cls[a] == cls[b];
+					}
+					if (same)
+						next[u] = next[w];
+				}
+				if (next[u] == -1)
+					next[u] = count++;
+			}
+			for (int u = 0; u <= N; ++u)
+				cls[u] = next[u];
+		}
+		// states numbered in breadth first order from the start state
+		int dead = partial ? cls[N] : -1, idOf[N + 1] = {}, k = 0;
+		for (int c = 0; c <= N; ++c)
+			idOf[c] = -1;
+		for (int u = 0; u < N; ++u)
+			newId[u] = -1;
+		for (int h = 0; h < tail; ++h) {
+			int u = que[h];
+			if (cls[u] == dead) {
+				if (u == startStateIndex)
+					rep[k++] = u; // empty language, a single state without transitions
+				continue;
+			}
+			if (idOf[cls[u]] == -1) {
+				idOf[cls[u]] = k;
+				rep[k++] = u;
+			}
+			newId[u] = idOf[cls[u]];
+		}
+		return k;
+	}
+public:
+	// symbol of every id, e.g. {'0', '1'}
+	constexpr StaticDeterministicFiniteAutomaton(const int (&syms)[M]) : symbols(), byteId(), table(), acceptStates(), startStateIndex(0) {
+		for (int b = 0; b < 256; ++b)
+			byteId[b] = -1;
+		for (int j = 0; j < M; ++j) {
+			for (int i = 0; i < j; ++i)
+				if (symbols[i] == syms[j])
+					RE("[Error] StaticDFA : Symbol \'%s\' appears twice in the alphabet.", symbolize(syms[j]).c_str());
+			symbols[j] = syms[j];
+			if (syms[j] >= -128 && syms[j] <= 255)
+				byteId[syms[j] & 0xFF] = j;
+		}
+		for (int u = 0; u < N; ++u)
+			for (int j = 0; j < M; ++j)
+				table[u][j] = -1;
+	}
+	// string literal alphabet, e.g. "01"
+	constexpr StaticDeterministicFiniteAutomaton(const char (&syms)[M + 1]) : StaticDeterministicFiniteAutomaton(toInts(syms)) {}
+	constexpr int size() const {
+		return N;
+	}
+	constexpr int alphabetSize() const {
+		return M;
+	}
+	constexpr int start() const {
+		return startStateIndex;
+	}
+	constexpr int symbol(int symbId) const {
+		if (symbId < 0 || symbId >= M)
+			RE("[Error] StaticDFA::symbol : Invalid symbol id (%d) violates the range [0, %d].", symbId, M - 1);
+		return symbols[symbId];
+	}
+	// -1 for symbols out of the alphabet
+	constexpr int symbolId(int c) const {
+		if (c >= -128 && c <= 255 && byteId[c & 0xFF] != -1 && symbols[byteId[c & 0xFF]] == c)
+			return byteId[c & 0xFF];
+		for (int j = 0; j < M; ++j)
+			if (symbols[j] == c)
+				return j;
+		return -1;
+	}
+	constexpr bool complete() const {
+		for (int u = 0; u < N; ++u)
+			for (int j = 0; j < M; ++j)
+				if (table[u][j] == -1)
+					return false;
+		return true;
+	}
+	constexpr void setStartState(int index) {
+		checkState(index, "setStartState");
+		startStateIndex = index;
+	}
+	constexpr void setTransition(int index1, int symbol, int index2) {
+		checkState(index1, "setTransition");
+		if (index2 != -1)
+			checkState(index2, "setTransition");
+		table[index1][symbolIdChecked(symbol, "setTransition")] = index2;
+	}
+	constexpr void flipStateAcceptance(int index) {
+		checkState(index, "flipStateAcceptance");
+		acceptStates[index] = !acceptStates[index];
+	}
+	constexpr bool isAcceptState(int index) const {
+		if (index == -1)
+			return false;
+		checkState(index, "isAcceptState");
+		return acceptStates[index];
+	}
+	constexpr int transition(int index, int symbol) const {
+		int symbId = symbolIdChecked(symbol, "transition");
+		if (index == -1)
+			return -1;
+		checkState(index, "transition");
+		return table[index][symbId];
+	}
+	// state after reading [first, last) from index, -1 once an empty transition is met
+	constexpr int run(int index, const char *first, const char *last) const {
+		if (index != -1)
+			checkState(index, "run");
+		for (; first != last; ++first) {
+			int symbId = byteId[(unsigned char)*first];
+			if (symbId == -1 || symbols[symbId] != (int)*first)
+				symbId = symbolIdChecked((int)*first, "run");
+			if (index != -1)
+				index = table[index][symbId];
+		}
+		return index;
+	}
+	constexpr bool match(const char *first, const char *last) const {
+		return isAcceptState(run(startStateIndex, first, last));
+	}
+	// null-terminated string
+	constexpr bool match(const char *symbString) const {
+		const char *last = symbString;
+		while (*last)
+			++last;
+		return match(symbString, last);
+	}
+	bool match(const std::string &symbString) const {
+		return match(symbString.data(), symbString.data() + symbString.length());
+	}
+	// size of the minimal automaton, the template argument of minimize
+	constexpr int minimizedSize() const {
+		int newId[N] = {}, rep[N] = {};
+		return minimalClasses(newId, rep);
+	}
+	// minimal automaton with K = minimizedSize() states, start state 0
+	template <int K>
+	constexpr StaticDeterministicFiniteAutomaton<K, M> minimize() const {
+		static_assert(K > 0 && K <= N, "StaticDFA::minimize : The minimal size is in [1, N].");
+		int newId[N] = {}, rep[N] = {};
+		int k = minimalClasses(newId, rep);
+		if (k != K)
+			RE("[Error] StaticDFA::minimize : Template size (%d) differs from the minimal size (%d).", K, k);
+		StaticDeterministicFiniteAutomaton<K, M> ret(symbols);
+		for (int i = 0; i < K; ++i) {
+			for (int j = 0; j < M; ++j) {
+				int v = table[rep[i]][j];
+				ret.table[i][j] = v == -1 ? -1 : newId[v];
+			}
+			ret.acceptStates[i] = acceptStates[rep[i]];
+		}
+		return ret;
+	}
+	// the same automaton for the dynamic library
+	DeterministicFiniteAutomaton toDFA() const {
+		std::shared_ptr<std::vector<int>> syms = std::make_shared<std::vector<int>>(symbols, symbols + M);
+		StaticDeterministicFiniteAutomaton copy(*this);
+		Alphabet alph(M, [syms](int id) { return (*syms)[id]; }, [copy](int c) { return copy.symbolId(c); });
+		DeterministicFiniteAutomaton ret(alph);
+		ret.setSize(N);
+		for (int u = 0; u < N; ++u) {
+			for (int j = 0; j < M; ++j)
+				if (table[u][j] != -1)
+					ret.setTransition(ret[u], symbols[j], ret[table[u][j]]);
+			if (acceptStates[u])
+				ret.flipStateAcceptance(ret[u]);
+		}
+		ret.setStartState(ret[startStateIndex]);
+		return ret;
+	}
+private:
+	struct IntArray {
+		int data[M];
+	};
+	static constexpr IntArray toInts(const char (&syms)[M + 1]) {
+		IntArray ret = {};
+		for (int j = 0; j < M; ++j)
+			ret.data[j] = (int)syms[j];
+		return ret;
+	}
+	constexpr StaticDeterministicFiniteAutomaton(const IntArray &syms) : StaticDeterministicFiniteAutomaton(syms.data) {}
+};
+
+#undef RE
+
+#endif
+
+#endif
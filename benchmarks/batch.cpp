@@ -0,0 +1,54 @@
+#include "../DFA.h"
+#include <chrono>
+#include <random>
+
+// compares transitionBatch with calling start().transition(str) for every key
+// usage: batch [states] [keys]
+int main(int argc, char **argv) {
+	using DFA = DeterministicFiniteAutomaton;
+	int states = argc > 1 ? std::atoi(argv[1]) : 100000;
+	int keys = argc > 2 ? std::atoi(argv[2]) : 1000000;
+	const std::string chars = "abcdefghijklmnopqrstuvwxyz0123456789./:-_?=&";
+	int m = (int)chars.size();
+	std::vector<int> pos(256, -1);
+	for (int i = 0; i < m; ++i)
+		pos[(unsigned char)chars[i]] = i;
+	Alphabet alph(m, [&chars](int x) { return (int)chars[x]; }, [pos](int x) { return x >= 0 && x < 256 ? pos[x] : -1; });
+	std::mt19937 rng(20220422);
+	DFA A(alph);
+	A.setSize(states);
+	for (int i = 0; i < states; ++i)
+		for (int j = 0; j < m; ++j)
+			A.setTransition(A[i], chars[j], A[(int)(rng() % states)]);
+	A.setStartState(A[0]);
+	for (int i = 0; i < states; i += 3)
+		A.flipStateAcceptance(A[i]);
+	std::vector<std::string> inputs(keys);
+	for (std::string &str : inputs) {
+		int len = 8 + (int)(rng() % 33);
+		for (int k = 0; k < len; ++k)
+			str += chars[rng() % m];
+	}
+	size_t totalBytes = 0;
+	for (const std::string &str : inputs)
+		totalBytes += str.length();
+
+	auto t0 = std::chrono::steady_clock::now();
+	std::vector<int> loopFinals(keys);
+	for (int i = 0; i < keys; ++i)
+		loopFinals[i] = A.start().transition(inputs[i]).index();
+	auto t1 = std::chrono::steady_clock::now();
+	std::vector<int> batchFinals = A.transitionBatch(inputs);
+	auto t2 = std::chrono::steady_clock::now();
+
+	if (loopFinals != batchFinals) {
+		std::printf("mismatch between the loop and the batch results\n");
+		return 1;
+	}
+	double loopSec = std::chrono::duration<double>(t1 - t0).count();
+	double batchSec = std::chrono::duration<double>(t2 - t1).count();
+	std::printf("states = %d, keys = %d, bytes = %zu, table entry width = %d\n", states, keys, totalBytes, states <= 0xFF ? 1 : states <= 0xFFFF ? 2 : 4);
+	std::printf("loop  : %.3f s, %.1f MB/s\n", loopSec, totalBytes / loopSec / 1e6);
+	std::printf("batch : %.3f s, %.1f MB/s\n", batchSec, totalBytes / batchSec / 1e6);
+	return 0;
+}
@@ -0,0 +1,303 @@
+#include "generators.h"
+#include "../NFA.h"
+#include "../RuleSet.h"
+#include "../DictionaryBuilder.h"
+#include <set>
+
+// randomized cross-checks of the newer builders against plain reference implementations:
+// the NFA simulator and subset construction against a set simulation, RuleSet against stepping every rule,
+// DictionaryBuilder against the minimized trie, and the acyclic (Revuz) minimization against minimize
+// prints one line per check, a check stops at its first mismatch and the exit code is 1 after any
+// usage: check [rounds] [seed]
+using DFA = DeterministicFiniteAutomaton;
+using NFA = NondeterministicFiniteAutomaton;
+
+static int failures;
+
+static bool expect(bool ok, const char *check, int round, const char *what) {
+	if (!ok) {
+		std::printf("%s: round %d, %s\n", check, round, what);
+		++failures;
+	}
+	return ok;
+}
+
+static std::string randomWord(std::mt19937 &rng, int maxLength, int m) {
+	std::string ret;
+	for (int len = (int)(rng() % (unsigned)(maxLength + 1)); len--; )
+		ret += (char)('a' + rng() % m);
+	return ret;
+}
+
+static bool accepts(const DFA &A, const std::string &str) {
+	for (char c : str) {
+		int symbId = A.alphabet().lookup(c);
+		if (symbId < 0 || symbId >= A.alphabetSize())
+			return false;
+	}
+	DFA::State s = A.start().transition(str);
+	return s.valid() && s.accept();
+}
+
+// the NFA and its edges kept aside for the reference simulation
+struct NFACase {
+	NFA nfa;
+	std::vector<std::vector<std::pair<int, int>>> edges; // (symbol, target)
+	std::vector<std::vector<int>> epsilon;
+	std::vector<int> starts;
+	std::vector<unsigned char> accept;
+};
+
+// shape 0: arbitrary edges and epsilon edges, 1: every state entered on a single symbol (Glushkov positions), 2: a chain
+static NFACase randomNFA(std::mt19937 &rng, int n, int m, int shape) {
+	NFACase ret;
+	ret.nfa = NFA(letterAlphabet(m));
+	ret.nfa.setSize(n);
+	ret.edges.resize(n), ret.epsilon.resize(n), ret.accept.assign(n, 0u);
+	std::vector<int> entry(n);
+	for (int v = 0; v < n; ++v)
+		entry[v] = 'a' + (int)(rng() % m);
+	auto edge = [&](int u, int c, int v) {
+		ret.nfa.addTransition(u, c, v);
+		ret.edges[u].emplace_back(c, v);
+	};
+	if (shape == 2)
+		for (int u = 0; u + 1 < n; ++u)
+			edge(u, entry[u + 1], u + 1);
+	else
+		for (int k = (int)(rng() % (unsigned)(3 * n)); k--; ) {
+			int u = (int)(rng() % n), v = (int)(rng() % n);
+			edge(u, shape == 1 ? entry[v] : 'a' + (int)(rng() % m), v);
+		}
+	for (int k = shape == 0 ? (int)(rng() % (unsigned)n) : 0; k--; ) {
+		int u = (int)(rng() % n), v = (int)(rng() % n);
+		ret.nfa.addEpsilonTransition(u, v);
+		ret.epsilon[u].push_back(v);
+	}
+	ret.starts.push_back(0);
+	if (shape == 0 && rng() % 2)
+		ret.starts.push_back((int)(rng() % n));
+	for (int u : ret.starts)
+		ret.nfa.addStartState(u);
+	for (int u = 0; u < n; ++u)
+		if (rng() % 4 == 0) {
+			ret.nfa.setAcceptState(u);
+			ret.accept[u] = 1u;
+		}
+	return ret;
+}
+
+static bool referenceAccepts(const NFACase &c, const std::string &str) {
+	int n = (int)c.accept.size();
+	std::vector<unsigned char> cur(n, 0u), next;
+	auto close = [&c](std::vector<unsigned char> &set) {
+		std::vector<int> stack;
+		for (int u = 0; u < (int)set.size(); ++u)
+			if (set[u])
+				stack.push_back(u);
+		while (!stack.empty()) {
+			int u = stack.back();
+			stack.pop_back();
+			for (int v : c.epsilon[u])
+				if (!set[v])
+					set[v] = 1u, stack.push_back(v);
+		}
+	};
+	for (int u : c.starts)
+		cur[u] = 1u;
+	close(cur);
+	for (char ch : str) {
+		next.assign(n, 0u);
+		for (int u = 0; u < n; ++u)
+			if (cur[u])
+				for (const std::pair<int, int> &e : c.edges[u])
+					if (e.first == ch)
+						next[e.second] = 1u;
+		close(next);
+		cur.swap(next);
+	}
+	for (int u = 0; u < n; ++u)
+		if (cur[u] && c.accept[u])
+			return true;
+	return false;
+}
+
+static void checkNFA(int rounds, unsigned seed) {
+	std::mt19937 rng(seed);
+	int modes[4] = {0, 0, 0, 0};
+	for (int round = 0; round < rounds; ++round) {
+		int m = 1 + (int)(rng() % 4), shape = round % 3;
+		int n = 1 + (int)(rng() % (round % 2 ? 150 : 64));
+		NFACase c = randomNFA(rng, n, m, shape);
+		NFA::Simulator sim = c.nfa.simulator();
+		++modes[sim.mode()];
+		DFA A = c.nfa.toDFA();
+		for (int t = 0; t < 40; ++t) {
+			std::string str = randomWord(rng, 12, m);
+			bool want = referenceAccepts(c, str);
+			if (!expect(sim.accepts(str) == want, "nfa", round, "simulator differs from the set simulation")
+				|| !expect(accepts(A, str) == want, "nfa", round, "toDFA differs from the set simulation"))
+				return ;
+		}
+	}
+	std::printf("nfa: %d rounds, modes bitset %d word %d glushkov %d shift_and %d\n", rounds, modes[0], modes[1], modes[2], modes[3]);
+}
+
+// random rule over sig with some empty transitions, states accepting with probability 1/2
+static DFA randomRule(const Alphabet &sig, int n, std::mt19937 &rng, double emptyRatio) {
+	DFA A(sig);
+	A.setSize(n);
+	std::uniform_real_distribution<double> coin(0.0, 1.0);
+	for (int u = 0; u < n; ++u)
+		for (int j = 0; j < sig.size(); ++j)
+			if (coin(rng) >= emptyRatio)
+				A.setTransition(A[u], sig.i2c(j), A[(int)(rng() % n)]);
+	for (int u = 0; u < n; ++u)
+		if (rng() % 2)
+			A.flipStateAcceptance(A[u]);
+	A.setStartState(A[0]);
+	return A;
+}
+
+static void checkRuleSet(int rounds, unsigned seed) {
+	std::mt19937 rng(seed);
+	Alphabet digits(10, [](int x) { return x + '0'; }, [](int c) { return c - '0'; });
+	for (int round = 0; round < rounds; ++round) {
+		std::vector<DFA> rules;
+		int cnt = 1 + (int)(rng() % 150);
+		for (int i = 0; i < cnt; ++i) {
+			int kind = (int)(rng() % 3);
+			if (kind == 0)
+				rules.push_back(randomRule(digits, 1 + (int)(rng() % 6), rng, 0.2));
+			else
+				rules.push_back(randomRule(letterAlphabet(26), 1 + (int)(rng() % (kind == 1 ? 4 : 40)), rng, round % 2 ? 0.05 : 0.0));
+		}
+		RuleSet R;
+		for (const DFA &A : rules)
+			R.addRule(A);
+		R.build(1 + (int)(rng() % 64), 2 + (int)(rng() % 64));
+		for (int t = 0; t < 20; ++t) {
+			const std::string pool = t % 3 == 0 ? "0123456789" : t % 3 == 1 ? "abc" : "abcdefghijklmnopqrstuvwxyz0";
+			std::string str;
+			for (int len = (int)(rng() % (t < 10 ? 8 : 2000)); len--; )
+				str += pool[rng() % pool.size()];
+			std::vector<int> want;
+			for (int i = 0; i < cnt; ++i)
+				if (accepts(rules[i], str))
+					want.push_back(i);
+			if (!expect(R.match(str) == want, "ruleset", round, "match differs from the rules one by one")
+				|| !expect(R.match(std::vector<int>(str.begin(), str.end())) == want, "ruleset", round, "match of symbols differs from the rules one by one"))
+				return ;
+		}
+	}
+	std::printf("ruleset: %d rounds\n", rounds);
+}
+
+// the minimal automaton of the words through the trie
+static DFA referenceDictionary(std::vector<std::string> words, int m) {
+	std::sort(words.begin(), words.end());
+	words.erase(std::unique(words.begin(), words.end()), words.end());
+	return trieDFA(words, m).minimize();
+}
+
+static void checkDictionary(int rounds, unsigned seed) {
+	std::mt19937 rng(seed);
+	for (int round = 0; round < rounds; ++round) {
+		int m = 1 + (int)(rng() % 5), cnt = (int)(rng() % 80);
+		std::vector<std::string> words;
+		for (int i = 0; i < cnt; ++i)
+			words.push_back(randomWord(rng, 8, m));
+		// sorted, unsorted, and sorted with a single word out of order
+		int order = round % 3;
+		if (order != 1)
+			std::sort(words.begin(), words.end());
+		if (order == 2 && cnt > 1)
+			std::swap(words[0], words[cnt / 2]);
+		DictionaryBuilder builder(letterAlphabet(m));
+		std::vector<std::string> added;
+		for (const std::string &w : words) {
+			builder.addWord(w);
+			added.push_back(w);
+			// minimal after every word once the general algorithm is used
+			if (!builder.sorted() && !expect(builder.size() == referenceDictionary(added, m).size(), "dictionary", round, "not minimal after a word"))
+				return ;
+		}
+		std::set<std::string> distinct(words.begin(), words.end());
+		DFA want = referenceDictionary(words, m), got = builder.toDFA();
+		if (!expect(builder.words() == distinct.size(), "dictionary", round, "wrong word count")
+			|| !expect(got.size() == want.size() && got.equivalent(want) && builder.size() == got.size(), "dictionary", round, "toDFA differs from the minimized trie"))
+			return ;
+		// words added after toDFA
+		words.push_back(randomWord(rng, 8, m));
+		builder.addWord(words.back());
+		want = referenceDictionary(words, m), got = builder.toDFA();
+		if (!expect(got.size() == want.size() && got.equivalent(want), "dictionary", round, "toDFA after more words differs from the minimized trie"))
+			return ;
+	}
+	std::printf("dictionary: %d rounds\n", rounds);
+}
+
+// acyclic apart from a few dead states which may loop among themselves, partial or completed with a sink
+static DFA randomAcyclic(std::mt19937 &rng, int round) {
+	int n = 1 + (int)(rng() % 60), m = 1 + (int)(rng() % 4), dead = (int)(rng() % 5);
+	DFA A(letterAlphabet(m));
+	A.setSize(n + dead + 1);
+	for (int u = 0; u < n; ++u)
+		for (int j = 0; j < m; ++j) {
+			int r = (int)(rng() % 10);
+			if (r < 5 && u + 1 < n)
+				A.setTransition(A[u], 'a' + j, A[u + 1 + (int)(rng() % (n - u - 1))]);
+			else if (r < 7 && dead)
+				A.setTransition(A[u], 'a' + j, A[n + (int)(rng() % dead)]);
+		}
+	for (int d = 0; d < dead; ++d)
+		for (int j = 0; j < m; ++j)
+			if (rng() % 2)
+				A.setTransition(A[n + d], 'a' + j, A[n + (int)(rng() % dead)]);
+	for (int u = 0; u < n; ++u)
+		if (rng() % 3 == 0) {
+			if (round % 3 == 0)
+				A.setAcceptLabel(A[u], (int)(rng() % 3));
+			else
+				A.flipStateAcceptance(A[u]);
+		}
+	if (round % 2) {
+		int sink = n + dead;
+		for (int u = 0; u <= sink; ++u)
+			for (int j = 0; j < m; ++j)
+				if (!A[u].transition('a' + j).valid())
+					A.setTransition(A[u], 'a' + j, A[sink]);
+	}
+	A.setStartState(A[(int)(rng() % n)]);
+	if (round % 4 == 1)
+		A.compressAlphabet();
+	if (round % 4 == 2)
+		A.useSparseTransitions();
+	return A;
+}
+
+static void checkAcyclic(int rounds, unsigned seed) {
+	std::mt19937 rng(seed);
+	for (int round = 0; round < rounds; ++round) {
+		DFA A = randomAcyclic(rng, round);
+		if (!expect(samePartition(A.equivalenceClassesAcyclic(), A.equivalenceClasses()), "acyclic", round, "equivalenceClassesAcyclic differs from equivalenceClasses"))
+			return ;
+		DFA B = A.minimize(), C = A.minimizeAcyclic(), D = DFA(A).minimizeAcyclic();
+		if (!expect(B.size() == C.size() && D.size() == C.size() && B.complete() == C.complete() && B.equivalent(C) && B.equivalent(D), "acyclic", round, "minimizeAcyclic differs from minimize"))
+			return ;
+		for (int u = 0; u < B.size(); ++u)
+			if (!expect(B.acceptLabel(B[u]) == C.acceptLabel(C[u]), "acyclic", round, "minimizeAcyclic labels differ from minimize"))
+				return ;
+	}
+	std::printf("acyclic: %d rounds\n", rounds);
+}
+
+int main(int argc, char **argv) {
+	int rounds = argc > 1 ? std::atoi(argv[1]) : 300;
+	unsigned seed = argc > 2 ? (unsigned)std::atoi(argv[2]) : 20221016u;
+	checkNFA(rounds, seed);
+	checkRuleSet(std::max(1, rounds / 10), seed + 1);
+	checkDictionary(rounds, seed + 2);
+	checkAcyclic(rounds, seed + 3);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,146 @@
+// PinkRabbit
+// 2026-10-16
+// Seeded automata for the benchmarks: random complete DFAs, modulo counters and hard cases for minimization
+
+#ifndef GENERATORS_H__PINKRABBIT
+#define GENERATORS_H__PINKRABBIT
+
+#include "../DFA.h"
+#include <random>
+
+// symbols 0 .. m - 1 are their own ids
+Alphabet integerAlphabet(int m) {
+	return Alphabet(m, [](int x) { return x; }, [](int x) { return x; });
+}
+
+// n states, every transition to a uniformly random state, each state accepting with the given probability
+DeterministicFiniteAutomaton randomDFA(int n, int m, unsigned seed, double acceptRatio = 0.5) {
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<double> coin(0.0, 1.0);
+	DeterministicFiniteAutomaton A(integerAlphabet(m));
+	A.setSize(n);
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < m; ++j)
+			A.setTransition(A[i], j, A[(int)(rng() % n)]);
+	for (int i = 0; i < n; ++i)
+		if (coin(rng) < acceptRatio)
+			A.flipStateAcceptance(A[i]);
+	A.setStartState(A[0]);
+	return A;
+}
+
+// base-b numbers divisible by k, as in example1.cpp, digits are the symbols '0'.. for b <= 10 and 0.. otherwise
+DeterministicFiniteAutomaton moduloDFA(int k, int b = 10) {
+	Alphabet alph = b <= 10 ? Alphabet(b, [](int x) { return x + '0'; }, [](int x) { return x - '0'; }) : integerAlphabet(b);
+	DeterministicFiniteAutomaton A(alph);
+	A.setSize(k);
+	for (int i = 0; i < k; ++i)
+		for (int j = 0; j < b; ++j)
+			A.setTransition(A[i], alph.i2c(j), A[(int)(((long long)i * b + j) % k)]);
+	A.setStartState(A[0]);
+	A.flipStateAcceptance(A[0]);
+	return A;
+}
+
+// unary cycle of 2^order states labelled by a binary de Bruijn sequence, state i accepts when its bit is 1,
+// already minimal, and the worst case of Hopcroft's algorithm for unlucky splitter choices (Berstel and Carton)
+DeterministicFiniteAutomaton deBruijnDFA(int order) {
+	std::vector<int> bits, a(order + 1, 0);
+	// the FKM algorithm, concatenating the Lyndon words whose length divides order
+	std::function<void(int, int)> gen = [&](int t, int p) {
+		if (t > order) {
+			if (order % p == 0)
+				bits.insert(bits.end(), a.begin() + 1, a.begin() + p + 1);
+			return ;
+		}
+		a[t] = a[t - p];
+		gen(t + 1, p);
+		for (int j = a[t - p] + 1; j < 2; ++j) {
+			a[t] = j;
+			gen(t + 1, t);
+		}
+	};
+	gen(1, 1);
+	int n = (int)bits.size();
+	DeterministicFiniteAutomaton A(integerAlphabet(1));
+	A.setSize(n);
+	for (int i = 0; i < n; ++i) {
+		A.setTransition(A[i], 0, A[(i + 1) % n]);
+		if (bits[i])
+			A.flipStateAcceptance(A[i]);
+	}
+	A.setStartState(A[0]);
+	return A;
+}
+
+// a path of n states on every symbol with only the last one accepting, already minimal,
+// refinement by rounds (and the table filling algorithm) needs n - 1 of them
+DeterministicFiniteAutomaton chainDFA(int n, int m) {
+	DeterministicFiniteAutomaton A(integerAlphabet(m));
+	A.setSize(n);
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < m; ++j)
+			A.setTransition(A[i], j, A[std::min(i + 1, n - 1)]);
+	A.flipStateAcceptance(A[n - 1]);
+	A.setStartState(A[0]);
+	return A;
+}
+
+// letters 'a' .. for symbol ids 0 .. m - 1
+Alphabet letterAlphabet(int m) {
+	return Alphabet(m, [](int x) { return x + 'a'; }, [](int c) { return c - 'a'; });
+}
+
+// the trie of sorted distinct words over letterAlphabet(m), as it is built before minimization, acyclic and partial
+DeterministicFiniteAutomaton trieDFA(const std::vector<std::string> &words, int m) {
+	std::vector<int> edges, accept, path(1, 0);
+	int n = 1;
+	std::string last;
+	for (const std::string &w : words) {
+		size_t p = 0;
+		while (p < w.length() && p < last.length() && w[p] == last[p])
+			++p;
+		path.resize(p + 1);
+		for (size_t i = p; i < w.length(); ++i) {
+			edges.push_back(path.back()), edges.push_back(w[i]), edges.push_back(n);
+			path.push_back(n++);
+		}
+		accept.push_back(path.back());
+		last = w;
+	}
+	DeterministicFiniteAutomaton A(letterAlphabet(m));
+	A.setSize(n);
+	A.setTransitions(edges);
+	for (int u : accept)
+		A.flipStateAcceptance(A[u]);
+	A.setStartState(A[0]);
+	return A;
+}
+
+// count strings with lengths in [minLength, maxLength] over the given characters
+std::vector<std::string> randomStrings(int count, int minLength, int maxLength, const std::string &chars, unsigned seed) {
+	std::mt19937 rng(seed);
+	std::vector<std::string> ret(count);
+	for (std::string &str : ret) {
+		int len = minLength + (int)(rng() % (unsigned)(maxLength - minLength + 1));
+		for (int i = 0; i < len; ++i)
+			str += chars[rng() % chars.size()];
+	}
+	return ret;
+}
+
+// the same partition up to the numbering of the classes
+bool samePartition(const std::vector<int> &a, const std::vector<int> &b) {
+	if (a.size() != b.size())
+		return false;
+	std::vector<int> ab(a.size(), -1), ba(b.size(), -1);
+	for (size_t i = 0; i < a.size(); ++i) {
+		if (ab[a[i]] == -1 && ba[b[i]] == -1)
+			ab[a[i]] = b[i], ba[b[i]] = a[i];
+		if (ab[a[i]] != b[i] || ba[b[i]] != a[i])
+			return false;
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,43 @@
+#include "../DFA.h"
+#include <chrono>
+#include <random>
+#include <sys/resource.h>
+
+// time and peak memory of equivalenceClasses (Hopcroft) on a random complete DFA
+// usage: hopcroft [states] [alphabet size] [seed]
+static long peakRssKiB() {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+int main(int argc, char **argv) {
+	using DFA = DeterministicFiniteAutomaton;
+	int n = argc > 1 ? std::atoi(argv[1]) : 100000;
+	int m = argc > 2 ? std::atoi(argv[2]) : 2;
+	unsigned seed = argc > 3 ? (unsigned)std::atoi(argv[3]) : 1u;
+	std::mt19937 rng(seed);
+	Alphabet alph(m, [](int x) { return x; }, [](int x) { return x; });
+	DFA A(alph);
+	A.setSize(n);
+	auto t0 = std::chrono::steady_clock::now();
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < m; ++j)
+			A.setTransition(A[i], j, A[(int)(rng() % n)]);
+	for (int i = 0; i < n; ++i)
+		if (rng() & 1)
+			A.flipStateAcceptance(A[i]);
+	A.setStartState(A[0]);
+	auto t1 = std::chrono::steady_clock::now();
+	long rssBefore = peakRssKiB();
+	std::vector<int> eqv = A.equivalenceClasses();
+	auto t2 = std::chrono::steady_clock::now();
+	long rssAfter = peakRssKiB();
+	int classes = *std::max_element(eqv.begin(), eqv.end()) + 1;
+	std::printf("n = %d, m = %d, classes = %d, build = %.3f s, hopcroft = %.3f s, peak rss = %.1f MiB (+%.1f MiB during hopcroft)\n",
+		n, m, classes,
+		std::chrono::duration<double>(t1 - t0).count(),
+		std::chrono::duration<double>(t2 - t1).count(),
+		rssAfter / 1024.0, (rssAfter - rssBefore) / 1024.0);
+	return 0;
+}
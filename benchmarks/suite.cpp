@@ -0,0 +1,186 @@
+#include "generators.h"
+#include "../DictionaryBuilder.h"
+#include <chrono>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+// the whole benchmark suite, one JSON object per line on stdout so that runs of two releases can be compared:
+//     {"bench": ..., "generator": ..., "n": ..., "m": ..., "states": ..., "seconds": ..., "rate": ..., "unit": ..., "table_bytes": ..., "peak_rss_kib": ...}
+// states is the size of the result (classes for the equivalence benchmarks, the automaton for matching), rate is counted in unit per second
+// usage: suite [scale] [seed] [threads], sizes grow linearly with scale, threads (0 for all cores) only for the parallel benchmarks
+using DFA = DeterministicFiniteAutomaton;
+
+// keeps the results of the matching loops alive
+static volatile int sink;
+
+static long peakRssKiB() {
+#if defined(__unix__) || defined(__APPLE__)
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return usage.ru_maxrss / 1024;
+#else
+	return usage.ru_maxrss;
+#endif
+#else
+	return -1;
+#endif
+}
+
+struct Timer {
+	std::chrono::steady_clock::time_point t0;
+	Timer() : t0(std::chrono::steady_clock::now()) {}
+	double seconds() const {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+	}
+};
+
+static void report(const char *bench, const std::string &generator, int n, int m, int states, double seconds, double amount, const char *unit, size_t tableBytes) {
+	std::printf("{\"bench\": \"%s\", \"generator\": \"%s\", \"n\": %d, \"m\": %d, \"states\": %d, \"seconds\": %.6f, \"rate\": %.1f, \"unit\": \"%s\", \"table_bytes\": %zu, \"peak_rss_kib\": %ld}\n",
+		bench, generator.c_str(), n, m, states, seconds, seconds > 0 ? amount / seconds : 0.0, unit, tableBytes, peakRssKiB());
+	std::fflush(stdout);
+}
+
+// largest order whose cycle has at most limit states
+static int deBruijnOrder(int limit) {
+	int order = 1;
+	while ((2 << order) <= limit)
+		++order;
+	return order;
+}
+
+static int classCount(const std::vector<int> &eqv) {
+	return eqv.empty() ? 0 : *std::max_element(eqv.begin(), eqv.end()) + 1;
+}
+
+static void benchBuild(int n, int m, unsigned seed) {
+	Timer timer;
+	DFA A = randomDFA(n, m, seed);
+	report("build", "random", n, m, A.size(), timer.seconds(), (double)n * m, "transitions", A.transitionBytes());
+}
+
+static void benchUnreachable(const std::string &generator, const DFA &A) {
+	Timer timer;
+	DFA B = A.eliminateUnreachableStates();
+	report("eliminate_unreachable", generator, A.size(), A.alphabetSize(), B.size(), timer.seconds(), A.size(), "states", B.transitionBytes());
+}
+
+// the table filling algorithm is quadratic in memory, so it only runs up to tableFillingLimit states
+static void benchEquivalence(const std::string &generator, const DFA &A, int tableFillingLimit) {
+	Timer timer;
+	std::vector<int> hopcroft = A.equivalenceClassesHopcroft();
+	report("equivalence_hopcroft", generator, A.size(), A.alphabetSize(), classCount(hopcroft), timer.seconds(), A.size(), "states", A.transitionBytes());
+	if (A.size() > tableFillingLimit)
+		return ;
+	timer = Timer();
+	std::vector<int> filling = A.equivalenceClassesTableFilling();
+	report("equivalence_table_filling", generator, A.size(), A.alphabetSize(), classCount(filling), timer.seconds(), A.size(), "states", A.transitionBytes());
+	if (!samePartition(hopcroft, filling)) {
+		std::fprintf(stderr, "equivalence classes of %s differ between the two algorithms\n", generator.c_str());
+		std::exit(1);
+	}
+}
+
+static void benchMinimize(const std::string &generator, const DFA &A) {
+	Timer timer;
+	DFA B = A.minimize(true);
+	report("minimize", generator, A.size(), A.alphabetSize(), B.size(), timer.seconds(), A.size(), "states", B.transitionBytes());
+}
+
+static void benchParallel(const std::string &generator, const DFA &A, int threads) {
+	Timer timer;
+	std::vector<int> parallel = A.equivalenceClassesParallel(threads);
+	report("equivalence_parallel", generator, A.size(), A.alphabetSize(), classCount(parallel), timer.seconds(), A.size(), "states", A.transitionBytes());
+	if (!samePartition(parallel, A.equivalenceClassesHopcroft())) {
+		std::fprintf(stderr, "equivalence classes of %s differ between the serial and the parallel algorithm\n", generator.c_str());
+		std::exit(1);
+	}
+	timer = Timer();
+	DFA B = A.minimizeParallel(threads, true);
+	report("minimize_parallel", generator, A.size(), A.alphabetSize(), B.size(), timer.seconds(), A.size(), "states", B.transitionBytes());
+}
+
+// the same dictionary built word by word, and minimized from its trie by both algorithms
+static void benchDictionary(std::vector<std::string> words, int m) {
+	std::sort(words.begin(), words.end());
+	words.erase(std::unique(words.begin(), words.end()), words.end());
+	int count = (int)words.size();
+	Timer timer;
+	DictionaryBuilder builder(letterAlphabet(m));
+	for (const std::string &w : words)
+		builder.addWord(w);
+	DFA A = builder.toDFA();
+	report("dictionary_build", "words", count, m, A.size(), timer.seconds(), count, "words", A.transitionBytes());
+	DFA trie = trieDFA(words, m);
+	timer = Timer();
+	DFA B = trie.minimize(true);
+	report("minimize", "trie", trie.size(), m, B.size(), timer.seconds(), trie.size(), "states", B.transitionBytes());
+	timer = Timer();
+	DFA C = trie.minimizeAcyclic(true);
+	report("minimize_acyclic", "trie", trie.size(), m, C.size(), timer.seconds(), trie.size(), "states", C.transitionBytes());
+	if (A.size() != B.size() || C.size() != B.size()) {
+		std::fprintf(stderr, "the dictionary automata differ in size\n");
+		std::exit(1);
+	}
+}
+
+static void benchMatch(const std::string &generator, const DFA &A, const std::vector<std::string> &keys, const std::string &text) {
+	size_t bytes = 0;
+	for (const std::string &str : keys)
+		bytes += str.length();
+	Timer timer;
+	int accepted = 0;
+	for (const std::string &str : keys)
+		accepted += A.start().transition(str).accept();
+	sink = accepted;
+	report("match_keys", generator, A.size(), A.alphabetSize(), A.size(), timer.seconds(), (double)bytes, "bytes", A.transitionBytes());
+	timer = Timer();
+	DFA::Matcher matcher = A.matcher();
+	matcher.feed(text);
+	sink = matcher.index();
+	report("match_stream", generator, A.size(), A.alphabetSize(), A.size(), timer.seconds(), (double)text.length(), "bytes", A.transitionBytes());
+}
+
+int main(int argc, char **argv) {
+	double scale = argc > 1 ? std::atof(argv[1]) : 1.0;
+	unsigned seed = argc > 2 ? (unsigned)std::atoi(argv[2]) : 20221016u;
+	int threads = argc > 3 ? std::atoi(argv[3]) : 0;
+	auto scaled = [scale](int x) {
+		return std::max(2, (int)(x * scale));
+	};
+
+	benchBuild(scaled(200000), 2, seed);
+	benchBuild(scaled(50000), 26, seed);
+
+	std::vector<std::pair<std::string, DFA>> cases;
+	cases.emplace_back("random", randomDFA(scaled(200000), 2, seed));
+	cases.emplace_back("random", randomDFA(scaled(20000), 26, seed + 1));
+	cases.emplace_back("modulo", moduloDFA(scaled(100000)));
+	cases.emplace_back("de_bruijn", deBruijnDFA(deBruijnOrder(scaled(65536))));
+	cases.emplace_back("chain", chainDFA(scaled(100000), 2));
+	for (const std::pair<std::string, DFA> &c : cases)
+		benchUnreachable(c.first, c.second);
+	for (const std::pair<std::string, DFA> &c : cases)
+		benchEquivalence(c.first, c.second, 0);
+	// small instances of the same families for the quadratic table filling algorithm
+	int small = scaled(2000);
+	benchEquivalence("random", randomDFA(small, 2, seed), small);
+	benchEquivalence("modulo", moduloDFA(small), small);
+	benchEquivalence("de_bruijn", deBruijnDFA(deBruijnOrder(small)), small);
+	benchEquivalence("chain", chainDFA(small, 2), small);
+	for (const std::pair<std::string, DFA> &c : cases)
+		benchMinimize(c.first, c.second);
+	for (const std::pair<std::string, DFA> &c : cases)
+		benchParallel(c.first, c.second, threads);
+
+	benchDictionary(randomStrings(scaled(200000), 3, 12, "abcdefgh", seed), 8);
+
+	std::string letters, digits = "0123456789";
+	for (int j = 0; j < 26; ++j)
+		letters += (char)j;
+	int keys = scaled(200000), textLength = scaled(1 << 24);
+	benchMatch("random", cases[1].second, randomStrings(keys, 8, 40, letters, seed), randomStrings(1, textLength, textLength, letters, seed + 1)[0]);
+	benchMatch("modulo", cases[2].second, randomStrings(keys, 8, 40, digits, seed), randomStrings(1, textLength, textLength, digits, seed + 1)[0]);
+	return 0;
+}
@@ -0,0 +1,31 @@
+#include "StaticDFA.h"
+
+// the mod-k example of example1.cpp fixed at compile time: base 10 numbers divisible by 6
+// the table and its minimization are computed by the compiler, and checked with static_assert
+template <int K>
+constexpr StaticDeterministicFiniteAutomaton<K, 10> modular() {
+	StaticDeterministicFiniteAutomaton<K, 10> A("0123456789");
+	for (int i = 0; i < K; ++i)
+		for (int j = 0; j < 10; ++j)
+			A.setTransition(i, '0' + j, (i * 10 + j) % K);
+	A.flipStateAcceptance(0);
+	return A;
+}
+
+constexpr auto A = modular<6>();
+constexpr auto B = A.minimize<A.minimizedSize()>();
+
+static_assert(A.match("114516") && !A.match("1919810"), "A accepts multiples of 6");
+static_assert(B.size() == 4, "remainders 1 and 4, and 2 and 5, lead to the same futures");
+static_assert(B.match("114516") && !B.match("1919810"), "B accepts the same numbers");
+
+int main() {
+	for (int i = 1; i <= 1000; ++i) {
+		std::string stri = std::to_string(i);
+		if ((i % 6 == 0) ^ B.match(stri))
+			printf("%9d : %s\n", i, B.match(stri) ? "accept" : "reject");
+	}
+	DeterministicFiniteAutomaton C = B.toDFA();
+	printf("C.size() = %d, equivalent to A : %s\n", C.size(), C.equivalent(A.toDFA()) ? "Yes" : "No");
+	return 0;
+}